@@ -2,6 +2,8 @@
 #include "action.h"
 #include "midi.h"
 #include "sdhi.h"
+#include "value.h"
+#include "setup_limits.h"
 
 static bool v_eq(const value_t v1, const value_t v2) {
   return v1.v1 == v2.v1 && v1.v2 == v2.v2 && v1.v3 == v2.v3;
@@ -11,10 +13,49 @@ static bool value_eq(const action_value_t value) {
   return v_eq(value.computed, value.sent);
 }
 
+#define XG_MAX_BATCH 64
+#define MAX_PARAMETERS 3
+
+// actions_t counts its actions in 8 bits, so every setup fits
+#if SETUP_MAX_ACTIONS <= UINT8_MAX
+#error SETUP_MAX_ACTIONS must cover every action index
+#endif
+
+// Actions using each control: control_actions[control_first[id]] up to
+// control_actions[control_first[id + 1]]
+static uint16_t control_first[SETUP_MAX_CONTROLS + 1];
+static uint8_t control_actions[SETUP_MAX_ACTIONS * MAX_PARAMETERS];
+
+// Some computed value differs from the sent one
+static bool unsent_actions;
+
+// Order in which changed actions are sent, see order_key
+static uint8_t order[SETUP_MAX_ACTIONS];
 static uint8_t current_action;
 
 static midi_message_t action_messages[8];
 
+// Reverse map from incoming messages to the action sending them, an open
+// addressing hash table kept at most half full
+#define RECEIVE_BITS 9
+#define RECEIVE_SLOTS (1 << RECEIVE_BITS)
+#define RECEIVE_EMPTY 0xFFFFFFFF
+#define RECEIVE_MESSAGES 8
+
+typedef enum {
+  RECEIVE_CONTROLLER,
+  RECEIVE_NRPN,
+  RECEIVE_PROGRAM
+} receive_type_t;
+
+static uint32_t receive_keys[RECEIVE_SLOTS];
+static uint8_t receive_actions[RECEIVE_SLOTS];
+
+// NRPN parameter selected on each channel by CC 99 and 98
+static bool nrpn_selected[16];
+static uint8_t nrpn_msb[16];
+static uint8_t nrpn_lsb[16];
+
 static uint8_t execute_action_controller(const action_controller_configuration_t configuration, const uint8_t channel, const value_t value, midi_message_t * const to_send) {
   midi_message_t message = {
     .type = MIDI_CONTROLLER_MESSAGE,
@@ -43,28 +84,76 @@ static uint8_t execute_action_rpn(const action_rpn_configuration_t configuration
   return 1;
 }
 
-static uint8_t execute_action_xg_parameter_change_1(const action_xg_parameter_change_1_configuration_t configuration, const uint8_t channel, const value_t value, midi_message_t * const to_send) {
-  uint8_t data[MIDI_EXCLUSIVE_MAX_LENGTH];
+#define XG_MANUFACTURER_ID 0x43
+#define XG_MODEL_ID 0x4C
+#define XG_PARAMETER_CHANGE 0x10
+#define XG_BULK_DUMP 0x00
+#define XG_MULTI_PART 0x08
 
-  data[0] = 0x08;
-  data[1] = channel & 0x7F;
-  data[2] = value.v1 & 0x7F;
-  data[3] = value.v2 & 0x7F;
+// Parameter of the multi part matching the channel
+static uint8_t execute_action_xg_parameter_change_1(const action_xg_parameter_change_1_configuration_t configuration, const uint8_t channel, const value_t value, midi_message_t * const to_send) {
+  const uint8_t data[] = {
+    XG_PARAMETER_CHANGE,
+    XG_MODEL_ID,
+    XG_MULTI_PART,
+    channel & 0x0F,
+    value.v1 & 0x7F,
+    value.v2 & 0x7F
+  };
 
   midi_message_t message = {
     .type = MIDI_EXCLUSIVE_MESSAGE,
     .value.exclusive = {
       .channel = channel & 0x7F,
-      .manufacturer_id = 0x43,
-      .data_size = 3
+      .manufacturer_id = XG_MANUFACTURER_ID,
+      .data_size = sizeof(data)
     }
   };
-  memcpy(message.value.exclusive.data, data, message.value.exclusive.data_size);
+  memcpy(message.value.exclusive.data, data, sizeof(data));
 
   to_send[0] = message;
   return 1;
 }
 
+// Consecutive parameters of a multi part in one bulk dump, split into
+// messages of MIDI_EXCLUSIVE_MAX_LENGTH
+static uint8_t execute_xg_bulk_dump(const uint8_t channel, const uint8_t address, const uint8_t * const values, const uint8_t size, midi_message_t * const to_send) {
+  uint8_t data[7 + XG_MAX_BATCH + 1];
+  uint8_t i = 0;
+  data[i++] = XG_BULK_DUMP;
+  data[i++] = XG_MODEL_ID;
+  data[i++] = size >> 7;
+  data[i++] = size & 0x7F;
+  data[i++] = XG_MULTI_PART;
+  data[i++] = channel & 0x0F;
+  data[i++] = address & 0x7F;
+  memcpy(data + i, values, size);
+  i += size;
+  // Byte count, address, data and checksum add up to 0
+  uint8_t sum = 0;
+  for(uint8_t j = 2; j < i; j++) {
+    sum += data[j];
+  }
+  data[i++] = -sum & 0x7F;
+
+  uint8_t messages = 0;
+  for(uint8_t j = 0; j < i; j += MIDI_EXCLUSIVE_MAX_LENGTH) {
+    midi_message_t message = {
+      .type = MIDI_EXCLUSIVE_MESSAGE,
+      .value.exclusive = {
+        .channel = channel & 0x7F,
+        .manufacturer_id = XG_MANUFACTURER_ID,
+        .data_size = MIN(i - j, MIDI_EXCLUSIVE_MAX_LENGTH),
+        .continued = j > 0,
+        .more = i - j > MIDI_EXCLUSIVE_MAX_LENGTH
+      }
+    };
+    memcpy(message.value.exclusive.data, data + j, message.value.exclusive.data_size);
+    to_send[messages++] = message;
+  }
+  return messages;
+}
+
 static uint8_t execute_action_bank_change(const uint8_t channel, const value_t value, midi_message_t * const to_send) {
   const midi_message_t c1 = {
     .type = MIDI_CONTROLLER_MESSAGE,
@@ -95,11 +184,21 @@ static uint8_t execute_action_bank_change(const uint8_t channel, const value_t v
   return 3;
 }
 
-static void execute_action_mapping(const action_mapping_configuration_t configuration, const uint8_t channel, const value_t value) {
-  midi_set_mapped_note(value.v1 & 0x7F, channel & 0x7F, value.v2 & 0x7F);
+// Every mapping action is its own target, numbered by its index
+static void execute_action_mapping(const action_mapping_configuration_t configuration, const uint8_t action, const midi_port_t port, const uint8_t channel, const value_t value) {
+  midi_set_mapped_note(action, value.v3 & 0x0F, value.v1 & 0x7F, port, channel & 0x0F, value.v2 & 0x7F, configuration.curve);
+}
+
+static bool send_action_messages(const midi_port_t port, const uint8_t messages) {
+  if(messages < midi_can_send_messages(port)) {
+    midi_send_messages(port, action_messages, messages);
+    return true;
+  } else {
+    return false;
+  }
 }
 
-static bool execute_action(const action_t action, const value_t value) {
+static bool execute_action(const action_t action, const uint8_t index, const value_t value) {
   uint8_t messages = 0;
   switch(action.type) {
   case ACTION_CONTROLLER:
@@ -112,36 +211,124 @@ static bool execute_action(const action_t action, const value_t value) {
     messages = execute_action_bank_change(action.channel, value, action_messages);
     break;
   case ACTION_MAPPING:
-    execute_action_mapping(action.configuration.mapping, action.channel, value);
+    execute_action_mapping(action.configuration.mapping, index, action.port, action.channel, value);
     messages = 0;
     break;
   case ACTION_XG_PARAMETER_CHANGE_1:
     messages = execute_action_xg_parameter_change_1(action.configuration.xg_parameter_change, action.channel, value, action_messages);
     break;
   }
-  if(messages < midi_can_send_messages()) {
-    midi_send_messages(action_messages, messages);
-    return true;
-  } else {
-    return false;
+  return send_action_messages(action.port, messages);
+}
+
+// Changed XG parameters from position on in the order that have the
+// same port and part and consecutive addresses
+static uint8_t xg_batch(const action_t * const actions, const uint8_t actions_size, const action_value_t * const action_values, const uint8_t position) {
+  const action_t * const first = &actions[order[position]];
+  const int32_t address = action_values[order[position]].computed.v1;
+  uint8_t size = 1;
+  while(size < XG_MAX_BATCH && position + size < actions_size) {
+    const uint8_t action = order[position + size];
+    if(actions[action].type != ACTION_XG_PARAMETER_CHANGE_1
+       || actions[action].port != first->port
+       || actions[action].channel != first->channel
+       || value_eq(action_values[action])
+       || action_values[action].computed.v1 != address + size) {
+      break;
+    }
+    size++;
   }
+  return size;
 }
 
-static void execute_actions(const action_t * const actions, const uint8_t actions_size, action_value_t * action_values) {
-  uint8_t last_action;
-  if(current_action == 0) {
-    last_action = actions_size - 1;
-  } else {
-    last_action = current_action - 1;
+static bool execute_xg_batch(const action_t * const actions, const action_value_t * const action_values, const uint8_t position, const uint8_t size) {
+  const action_t * const first = &actions[order[position]];
+  uint8_t values[XG_MAX_BATCH];
+  for(uint8_t i = 0; i < size; i++) {
+    values[i] = action_values[order[position + i]].computed.v2 & 0x7F;
   }
+  const uint8_t messages = execute_xg_bulk_dump(first->channel, action_values[order[position]].computed.v1, values, size, action_messages);
+  return send_action_messages(first->port, messages);
+}
 
-  for(; current_action != last_action; current_action = (current_action + 1) % actions_size) {
-    if(!value_eq(action_values[current_action]) && !execute_action(actions[current_action], action_values[current_action].computed)) {
-      break;
-    } else {
-      action_values[current_action].sent = action_values[current_action].computed;
+// Sends the changed actions starting where the last call stopped. A full
+// port only holds back the actions sent on it, the next call starts at
+// the first of them. Returns true if some port filled up before all were
+// sent.
+static bool execute_actions(const action_t * const actions, const uint8_t actions_size, action_value_t * action_values) {
+  bool full[MIDI_PORTS] = {false};
+  bool blocked = false;
+  uint8_t resume = current_action;
+  for(uint16_t i = 0; i < actions_size; i++) {
+    const uint8_t position = (current_action + i) % actions_size;
+    const uint8_t action = order[position];
+    if(!value_eq(action_values[action])) {
+      const midi_port_t port = actions[action].port;
+      const uint8_t batch = actions[action].type == ACTION_XG_PARAMETER_CHANGE_1 ? xg_batch(actions, actions_size, action_values, position) : 1;
+      if(full[port] || !(batch > 1 ? execute_xg_batch(actions, action_values, position, batch) : execute_action(actions[action], action, action_values[action].computed))) {
+        if(!blocked) {
+          resume = position;
+        }
+        full[port] = true;
+        blocked = true;
+        continue;
+      }
+      for(uint8_t j = 0; j < batch; j++) {
+        action_values[order[position + j]].sent = action_values[order[position + j]].computed;
+      }
     }
   }
+  // A blocked pass continues with the next call, so an (N)RPN may still
+  // be followed by another one on its channel
+  if(!blocked) {
+    midi_flush();
+  }
+  current_action = resume;
+  return blocked;
+}
+
+static uint8_t type_rank(const action_type_t type) {
+  switch(type) {
+  case ACTION_XG_PARAMETER_CHANGE_1:
+    return 0;
+  case ACTION_MAPPING:
+    return 1;
+  case ACTION_BANK_CHANGE:
+    return 2;
+  case ACTION_CONTROLLER:
+    return 3;
+  case ACTION_NRPN:
+    return 4;
+  }
+  return 5;
+}
+
+// Groups the messages of a port and channel so that they share running
+// status. System exclusive and program change break running status and
+// go first, XG parameters sorted by address so that consecutive ones are
+// sent as one bulk dump. NRPNs go last sorted by parameter so that
+// consecutive ones with the same MSB only send the LSB.
+static uint32_t order_key(const action_t action, const value_t value) {
+  uint32_t key = ((uint32_t)action.port << 28) | ((uint32_t)(action.channel & 0x0F) << 24) | ((uint32_t)type_rank(action.type) << 16);
+  if(action.type == ACTION_NRPN) {
+    key |= ((value.v1 & 0x7F) << 8) | (value.v2 & 0x7F);
+  } else if(action.type == ACTION_XG_PARAMETER_CHANGE_1) {
+    key |= value.v1 & 0x7F;
+  }
+  return key;
+}
+
+static void sort_actions(const action_t * const actions, const uint8_t actions_size, const action_value_t * const action_values) {
+  for(uint16_t i = 0; i < actions_size; i++) {
+    const uint8_t action = i;
+    const uint32_t key = order_key(actions[action], action_values[action].computed);
+    uint16_t j = i;
+    for(; j > 0 && order_key(actions[order[j - 1]], action_values[order[j - 1]].computed) > key; j--) {
+      order[j] = order[j - 1];
+    }
+    order[j] = action;
+  }
+  current_action = 0;
 }
 
 static int32_t parameter_value(const parameter_t parameter, const sdhi_t sdhi, const int32_t * const values) {
@@ -166,51 +353,277 @@ static int32_t parameter_value(const parameter_t parameter, const sdhi_t sdhi, c
   return value;
 }
 
+// Parameters of an action in the order of v1, v2 and v3
+static uint8_t action_parameters(const action_t * const action, parameter_t * const parameters) {
+  switch(action->type) {
+  case ACTION_CONTROLLER:
+    parameters[0] = action->configuration.controller.number;
+    parameters[1] = action->configuration.controller.value;
+    return 2;
+  case ACTION_NRPN:
+    parameters[0] = action->configuration.rpn.msb;
+    parameters[1] = action->configuration.rpn.lsb;
+    parameters[2] = action->configuration.rpn.value;
+    return 3;
+  case ACTION_BANK_CHANGE:
+    parameters[0] = action->configuration.bank_change.value;
+    return 1;
+  case ACTION_MAPPING:
+    parameters[0] = action->configuration.mapping.note;
+    parameters[1] = action->configuration.mapping.value;
+    parameters[2] = action->configuration.mapping.in_channel;
+    return 3;
+  case ACTION_XG_PARAMETER_CHANGE_1:
+    parameters[0] = action->configuration.xg_parameter_change.parameter;
+    parameters[1] = action->configuration.xg_parameter_change.value;
+    return 2;
+  }
+  return 0;
+}
+
+static void update_computed_value(const action_t * const action, const sdhi_t sdhi, const int32_t * const values, action_value_t * const action_value) {
+  parameter_t parameters[MAX_PARAMETERS];
+  const uint8_t size = action_parameters(action, parameters);
+  int32_t computed[MAX_PARAMETERS] = {0, 0, 0};
+  for(uint8_t i = 0; i < size; i++) {
+    computed[i] = parameter_value(parameters[i], sdhi, values);
+  }
+  action_value->computed.v1 = computed[0];
+  action_value->computed.v2 = computed[1];
+  action_value->computed.v3 = computed[2];
+  if(!value_eq(*action_value)) {
+    unsent_actions = true;
+  }
+}
+
 static void update_computed_values(const action_t * const actions, const uint8_t actions_size, const sdhi_t sdhi, const int32_t * const values, action_value_t * action_values) {
-  for(uint8_t i = 0; i < actions_size; i++) {
-    const action_t action = actions[i];
-    switch(action.type) {
-    case ACTION_CONTROLLER:
-      action_values[i].computed.v1 = parameter_value(action.configuration.controller.number, sdhi, values);
-      action_values[i].computed.v2 = parameter_value(action.configuration.controller.value, sdhi, values);
-      action_values[i].computed.v3 = 0;
-      break;
-    case ACTION_NRPN:
-      action_values[i].computed.v1 = parameter_value(action.configuration.rpn.msb, sdhi, values);
-      action_values[i].computed.v2 = parameter_value(action.configuration.rpn.lsb, sdhi, values);
-      action_values[i].computed.v3 = parameter_value(action.configuration.rpn.value, sdhi, values);
-      break;
-    case ACTION_BANK_CHANGE:
-      action_values[i].computed.v1 = parameter_value(action.configuration.bank_change.value, sdhi, values);
-      action_values[i].computed.v2 = 0;
-      action_values[i].computed.v3 = 0;
+  for(uint16_t i = 0; i < actions_size; i++) {
+    update_computed_value(&actions[i], sdhi, values, &action_values[i]);
+  }
+}
+
+static void index_controls(const action_t * const actions, const uint8_t actions_size) {
+  for(uint16_t i = 0; i <= SETUP_MAX_CONTROLS; i++) {
+    control_first[i] = 0;
+  }
+  // Count the actions of each control in control_first[id + 1], then
+  // turn the counts into start positions and fill in the actions
+  for(uint16_t i = 0; i < actions_size; i++) {
+    parameter_t parameters[MAX_PARAMETERS];
+    const uint8_t size = action_parameters(&actions[i], parameters);
+    for(uint8_t j = 0; j < size; j++) {
+      if(parameters[j].type == PARAMETER_CONTROL) {
+        if(parameters[j].parameter.control.id < 0 || parameters[j].parameter.control.id >= SETUP_MAX_CONTROLS) {
+          panic("Action control out of range!");
+        }
+        control_first[parameters[j].parameter.control.id + 1]++;
+      }
+    }
+  }
+  for(uint16_t i = 1; i <= SETUP_MAX_CONTROLS; i++) {
+    control_first[i] += control_first[i - 1];
+  }
+  uint16_t next[SETUP_MAX_CONTROLS];
+  memcpy(next, control_first, sizeof(next));
+  for(uint16_t i = 0; i < actions_size; i++) {
+    parameter_t parameters[MAX_PARAMETERS];
+    const uint8_t size = action_parameters(&actions[i], parameters);
+    for(uint8_t j = 0; j < size; j++) {
+      if(parameters[j].type == PARAMETER_CONTROL) {
+        control_actions[next[parameters[j].parameter.control.id]++] = i;
+      }
+    }
+  }
+}
+
+static uint32_t receive_key(const receive_type_t type, const uint8_t channel, const uint8_t msb, const uint8_t lsb) {
+  return ((uint32_t)type << 24) | ((uint32_t)(channel & 0x0F) << 16) | ((msb & 0x7F) << 8) | (lsb & 0x7F);
+}
+
+static uint16_t receive_slot(const uint32_t key) {
+  return (key * 2654435761u) >> (32 - RECEIVE_BITS);
+}
+
+// Parameter of the action carrying the received value, MAX_PARAMETERS if
+// the action can't be received. Only actions whose other parameters are
+// fixed values map back to a single control.
+static uint8_t receive_parameter(const action_t * const action, uint32_t * const key) {
+  parameter_t parameters[MAX_PARAMETERS];
+  action_parameters(action, parameters);
+  uint8_t value;
+  switch(action->type) {
+  case ACTION_CONTROLLER:
+    *key = receive_key(RECEIVE_CONTROLLER, action->channel, parameters[0].parameter.value, 0);
+    value = 1;
+    break;
+  case ACTION_NRPN:
+    *key = receive_key(RECEIVE_NRPN, action->channel, parameters[0].parameter.value, parameters[1].parameter.value);
+    value = 2;
+    break;
+  case ACTION_BANK_CHANGE:
+    *key = receive_key(RECEIVE_PROGRAM, action->channel, 0, 0);
+    value = 0;
+    break;
+  default:
+    return MAX_PARAMETERS;
+  }
+  for(uint8_t i = 0; i < value; i++) {
+    if(parameters[i].type != PARAMETER_VALUE) {
+      return MAX_PARAMETERS;
+    }
+  }
+  return parameters[value].type == PARAMETER_CONTROL ? value : MAX_PARAMETERS;
+}
+
+// The first action sending a message wins if several do
+static void index_receive(const action_t * const actions, const uint8_t actions_size) {
+  for(uint16_t i = 0; i < RECEIVE_SLOTS; i++) {
+    receive_keys[i] = RECEIVE_EMPTY;
+  }
+  for(uint16_t i = 0; i < actions_size; i++) {
+    uint32_t key;
+    if(receive_parameter(&actions[i], &key) == MAX_PARAMETERS) {
+      continue;
+    }
+    uint16_t slot = receive_slot(key);
+    while(receive_keys[slot] != RECEIVE_EMPTY && receive_keys[slot] != key) {
+      slot = (slot + 1) % RECEIVE_SLOTS;
+    }
+    if(receive_keys[slot] == RECEIVE_EMPTY) {
+      receive_keys[slot] = key;
+      receive_actions[slot] = i;
+    }
+  }
+  for(uint8_t i = 0; i < 16; i++) {
+    nrpn_selected[i] = false;
+  }
+}
+
+static int16_t receive_action(const uint32_t key) {
+  for(uint16_t slot = receive_slot(key); receive_keys[slot] != RECEIVE_EMPTY; slot = (slot + 1) % RECEIVE_SLOTS) {
+    if(receive_keys[slot] == key) {
+      return receive_actions[slot];
+    }
+  }
+  return -1;
+}
+
+static void set_parameter(value_t * const value, const uint8_t parameter, const int32_t v) {
+  switch(parameter) {
+  case 0:
+    value->v1 = v;
+    break;
+  case 1:
+    value->v2 = v;
+    break;
+  case 2:
+    value->v3 = v;
+    break;
+  }
+}
+
+// Takes the value the synth reports as sent. If the control can't show it
+// exactly, the computed value differs and the control's value is sent back.
+static void receive_value(const actions_t actions, const uint32_t key, const int32_t received, const sdhi_t sdhi, const int32_t * const values, action_value_t * action_values) {
+  const int16_t action = receive_action(key);
+  if(action < 0) {
+    return;
+  }
+  parameter_t parameters[MAX_PARAMETERS];
+  action_parameters(&actions.actions[action], parameters);
+  uint32_t unused;
+  const uint8_t parameter = receive_parameter(&actions.actions[action], &unused);
+  const parameter_control_t control = parameters[parameter].parameter.control;
+  int32_t stored;
+  if(!sdhi_stored_value(control.id, received - control.offset, &stored, sdhi)) {
+    return;
+  }
+  if(stored != values[control.id]) {
+    value_set(control.id, stored);
+  }
+  const bool unsent = unsent_actions;
+  update_computed_value(&actions.actions[action], sdhi, values, &action_values[action]);
+  action_values[action].sent = action_values[action].computed;
+  set_parameter(&action_values[action].sent, parameter, received);
+  unsent_actions = unsent || !value_eq(action_values[action]);
+}
+
+static void receive_controller(const actions_t actions, const controller_message_t controller, const sdhi_t sdhi, const int32_t * const values, action_value_t * action_values) {
+  const uint8_t channel = controller.channel & 0x0F;
+  switch(controller.number) {
+  case 99:
+    nrpn_selected[channel] = true;
+    nrpn_msb[channel] = controller.value;
+    return;
+  case 98:
+    nrpn_selected[channel] = true;
+    nrpn_lsb[channel] = controller.value;
+    return;
+  case 101:
+  case 100:
+    nrpn_selected[channel] = false;
+    return;
+  case 6:
+    if(nrpn_selected[channel]) {
+      receive_value(actions, receive_key(RECEIVE_NRPN, channel, nrpn_msb[channel], nrpn_lsb[channel]), controller.value, sdhi, values, action_values);
+      return;
+    }
+    break;
+  }
+  receive_value(actions, receive_key(RECEIVE_CONTROLLER, channel, controller.number, 0), controller.value, sdhi, values, action_values);
+}
+
+bool action_receive(const actions_t actions, const sdhi_t sdhi, const int32_t * const values, action_value_t * action_values) {
+  midi_message_t messages[RECEIVE_MESSAGES];
+  const uint32_t size = midi_get_available_messages(messages, RECEIVE_MESSAGES);
+  for(uint32_t i = 0; i < size; i++) {
+    switch(messages[i].type) {
+    case MIDI_CONTROLLER_MESSAGE:
+      receive_controller(actions, messages[i].value.controller, sdhi, values, action_values);
       break;
-    case ACTION_MAPPING:
-      action_values[i].computed.v1 = parameter_value(action.configuration.mapping.note, sdhi, values);
-      action_values[i].computed.v2 = parameter_value(action.configuration.mapping.value, sdhi, values);
-      action_values[i].computed.v3 = 0;
+    case MIDI_PROGRAM_CHANGE_MESSAGE:
+      receive_value(actions, receive_key(RECEIVE_PROGRAM, messages[i].value.program.channel, 0, 0), messages[i].value.program.number, sdhi, values, action_values);
       break;
-    case ACTION_XG_PARAMETER_CHANGE_1:
-      action_values[i].computed.v1 = parameter_value(action.configuration.xg_parameter_change.parameter, sdhi, values);
-      action_values[i].computed.v2 = parameter_value(action.configuration.xg_parameter_change.value, sdhi, values);
-      action_values[i].computed.v3 = 0;
+    default:
       break;
     }
   }
+  return unsent_actions;
 }
 
-void action_init(const actions_t const actions, const sdhi_t sdhi, const int32_t * const values, action_value_t * action_values) {
-  current_action = 0;
-  update_computed_values(actions.actions, actions.size, sdhi, values, action_values);
-  for(uint8_t i; i < actions.size; i++) {
-    while(!execute_action(actions.actions[i], action_values[i].computed)) {
-      sleep_ms(10);
+// Recomputes only the actions using values changed since the last call
+bool action_update(const actions_t actions, const sdhi_t sdhi, const int32_t * const values, action_value_t * action_values) {
+  for(int32_t id = value_next(VALUE_CONSUMER_ACTION); id != VALUE_NONE; id = value_next(VALUE_CONSUMER_ACTION)) {
+    if(id == VALUE_ALL) {
+      update_computed_values(actions.actions, actions.size, sdhi, values, action_values);
+      continue;
     }
-    action_values[i].sent = action_values[i].computed;
+    for(uint16_t i = control_first[id]; i < control_first[id + 1]; i++) {
+      update_computed_value(&actions.actions[control_actions[i]], sdhi, values, &action_values[control_actions[i]]);
+    }
+  }
+  if(unsent_actions) {
+    unsent_actions = execute_actions(actions.actions, actions.size, action_values);
   }
+  return unsent_actions;
 }
 
-void action_update(const actions_t actions, const sdhi_t sdhi, const int32_t * const values, action_value_t * action_values) {
+bool action_recall(const actions_t actions, const sdhi_t sdhi, const int32_t * const values, action_value_t * action_values) {
+  value_consume_all(VALUE_CONSUMER_ACTION);
   update_computed_values(actions.actions, actions.size, sdhi, values, action_values);
-  execute_actions(actions.actions, actions.size, action_values);
+  sort_actions(actions.actions, actions.size, action_values);
+  unsent_actions = execute_actions(actions.actions, actions.size, action_values);
+  return unsent_actions;
+}
+
+// Never equal to a computed value, so every action is sent once
+static const value_t unsent = {INT32_MIN, INT32_MIN, INT32_MIN};
+
+bool action_init(const actions_t const actions, const sdhi_t sdhi, const int32_t * const values, action_value_t * action_values) {
+  index_controls(actions.actions, actions.size);
+  index_receive(actions.actions, actions.size);
+  for(uint16_t i = 0; i < actions.size; i++) {
+    action_values[i].sent = unsent;
+  }
+  return action_recall(actions, sdhi, values, action_values);
 }
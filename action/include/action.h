@@ -1,6 +1,7 @@
 #pragma once
 #include <stdint.h>
 #include "sdhi.h"
+#include "midi.h"
 
 typedef struct {
   int32_t v1;
@@ -54,9 +55,13 @@ typedef struct {
   parameter_t value;
 } action_rpn_configuration_t;
 
+// Maps the received note on in_channel to the note value on the
+// action's channel, one of the targets the note is sent to
 typedef struct {
   parameter_t note;
   parameter_t value;
+  parameter_t in_channel;
+  midi_velocity_curve_t curve;
 } action_mapping_configuration_t;
 
 typedef struct {
@@ -73,6 +78,7 @@ typedef union {
 } action_configuration_t;
 
 typedef struct {
+  midi_port_t port;
   uint8_t channel;
   const action_type_t type;
   action_configuration_t configuration;
@@ -83,5 +89,18 @@ typedef struct {
   const uint8_t size;
 } actions_t;
 
-void action_init(const actions_t actions, const sdhi_t sdhi, const int32_t * const values, action_value_t * action_values);
-void action_update(const actions_t actions, const sdhi_t sdhi, const int32_t * const values, action_value_t * action_values);
+// Sends the state of every action. Does not wait for the MIDI queue, call
+// action_update while it returns true.
+bool action_init(const actions_t actions, const sdhi_t sdhi, const int32_t * const values, action_value_t * action_values);
+// Send the actions whose values changed since they were last sent. Both
+// return true if the MIDI queue filled up, action_update must then be
+// called again to send the rest.
+bool action_update(const actions_t actions, const sdhi_t sdhi, const int32_t * const values, action_value_t * action_values);
+// Applies the control and program changes received from the synth to
+// the values of the controls sending them, without sending them back.
+// Returns true if some received value could not be shown exactly and the
+// control's value has to be sent, see action_update.
+bool action_receive(const actions_t actions, const sdhi_t sdhi, const int32_t * const values, action_value_t * action_values);
+// For many changed values at once, e.g. after a preset recall. Sends the
+// changes in an order that keeps the MIDI stream short.
+bool action_recall(const actions_t actions, const sdhi_t sdhi, const int32_t * const values, action_value_t * action_values);
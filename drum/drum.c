@@ -1,10 +1,7 @@
 #include <stdio.h>
-#include <string.h>
 #include "pico/stdlib.h"
 #include "drum.h"
 
-#define NUMBER_OF_DRUMS 11
-
 enum controls {
   NONE = -1,
   DRUM_TYPE = 0,
@@ -79,95 +76,35 @@ static const shdi_control_type_enumeration_value_t clap_values[] = {
   { .name = "Sticks", .value = 32 }
 };
 
-typedef struct {
-  const char * name;
-  const uint8_t note;
-  const shdi_control_type_enumeration_value_t * values;
-  const uint8_t values_size;
-  const uint8_t initial;
-} drum_t;
+#define VALUES(values) values, sizeof(values) / sizeof(shdi_control_type_enumeration_value_t)
 
-drum_t drums[NUMBER_OF_DRUMS] = {
-  {
-    .name = "Bass drum",
-    .note = 36,
-    .values = kick_values,
-    .values_size = sizeof(kick_values) / sizeof(shdi_control_type_enumeration_value_t),
-    .initial = 0
-  },
-  {
-    .name = "Snare drum",
-    .note = 38,
-    .values = snare_values,
-    .values_size = sizeof(snare_values) / sizeof(shdi_control_type_enumeration_value_t),
-    .initial = 0
-  },
-  {
-    .name = "Low tom",
-    .note = 41,
-    .values = tom_values,
-    .values_size = sizeof(tom_values) / sizeof(shdi_control_type_enumeration_value_t),
-    .initial = 0
-  },
-  {
-    .name = "Mid tom",
-    .note = 43,
-    .values = tom_values,
-    .values_size = sizeof(tom_values) / sizeof(shdi_control_type_enumeration_value_t),
-    .initial = 3
-  },
-  {
-    .name = "High tom",
-    .note = 45,
-    .values = tom_values,
-    .values_size = sizeof(tom_values) / sizeof(shdi_control_type_enumeration_value_t),
-    .initial = 5
-  },
-  {
-    .name = "Snare rim",
-    .note = 40,
-    .values = snare_values,
-    .values_size = sizeof(snare_values) / sizeof(shdi_control_type_enumeration_value_t),
-    .initial = 3
-  },
-  {
-    .name = "Clap",
-    .note = 39,
-    .values = clap_values,
-    .values_size = sizeof(clap_values) / sizeof(shdi_control_type_enumeration_value_t),
-    .initial = 0
-  },
-  {
-    .name = "Cowbell",
-    .note = 56,
-    .values = cowbell_values,
-    .values_size = sizeof(cowbell_values) / sizeof(shdi_control_type_enumeration_value_t),
-    .initial = 0
-  },
-  {
-    .name = "Cymbal",
-    .note = 49,
-    .values = cymbal_values,
-    .values_size = sizeof(cymbal_values) / sizeof(shdi_control_type_enumeration_value_t),
-    .initial = 0
-  },
-  {
-    .name = "Open Hihat",
-    .note = 46,
-    .values = open_hihat_values,
-    .values_size = sizeof(open_hihat_values) / sizeof(shdi_control_type_enumeration_value_t),
-    .initial = 0
-  },
-  {
-    .name = "Closed Hihat",
-    .note = 42,
-    .values = closed_hihat_values,
-    .values_size = sizeof(closed_hihat_values) / sizeof(shdi_control_type_enumeration_value_t),
-    .initial = 0
-  },
+// Drum instances, X(index, name, note, values, values_size, initial).
+// Each instance gets its own copy of the controls, panels and actions
+// below with control ids offset by index * CONTROLS and MIDI channel
+// index. The tables are expanded by the preprocessor into const data so
+// the whole setup stays in flash.
+#define DRUMS(X)                                                \
+  X(0,  "Bass drum",    36, VALUES(kick_values),         0)    \
+  X(1,  "Snare drum",   38, VALUES(snare_values),        0)    \
+  X(2,  "Low tom",      41, VALUES(tom_values),          0)    \
+  X(3,  "Mid tom",      43, VALUES(tom_values),          3)    \
+  X(4,  "High tom",     45, VALUES(tom_values),          5)    \
+  X(5,  "Snare rim",    40, VALUES(snare_values),        3)    \
+  X(6,  "Clap",         39, VALUES(clap_values),         0)    \
+  X(7,  "Cowbell",      56, VALUES(cowbell_values),      0)    \
+  X(8,  "Cymbal",       49, VALUES(cymbal_values),       0)    \
+  X(9,  "Open Hihat",   46, VALUES(open_hihat_values),   0)    \
+  X(10, "Closed Hihat", 42, VALUES(closed_hihat_values), 0)
+
+#define COUNT(...) + 1
+enum {
+  NUMBER_OF_DRUMS = 0 DRUMS(COUNT)
 };
+#undef COUNT
+
+#define ID(drum, control) ((drum) * CONTROLS + (control))
 
-static shdi_control_type_enumeration_value_t sound_values[] = {
+static const shdi_control_type_enumeration_value_t sound_values[] = {
   { .name = "Standard",   .value = 0 },
   { .name = "Standard 2", .value = 1 },
   { .name = "Dry",        .value = 2 },
@@ -188,177 +125,162 @@ static shdi_control_type_enumeration_value_t sound_values[] = {
   { .name = "Symphony",   .value = 48 }
 };
 
-static char type_title[] = "Type";
-static char sound_title[] = "Variation";
-static char volume_title[] = "Volume";
-static char attack_title[] = "Attack";
-static char decay_title[] = "Decay";
-static char release_title[] = "Release";
-static char lpf_cutoff_title[] = "LPF Cutoff";
-static char lpf_resonance_title[] = "LPF Resonance";
-static char hpf_cutoff_title[] = "HPF Cutoff";
+static const char type_title[] = "Type";
+static const char sound_title[] = "Variation";
+static const char volume_title[] = "Volume";
+static const char attack_title[] = "Attack";
+static const char decay_title[] = "Decay";
+static const char release_title[] = "Release";
+static const char lpf_cutoff_title[] = "LPF Cutoff";
+static const char lpf_resonance_title[] = "LPF Resonance";
+static const char hpf_cutoff_title[] = "HPF Cutoff";
 
-static const sdhi_control_t const controls_template[] = {
-  {
-    .id = DRUM_TYPE,
-    .title = type_title,
-    .group = 0,
-    .type = SDHI_CONTROL_TYPE_ENUMERATION,
-  },
-  {
-    .id = DRUM_SOUND,
-    .title = sound_title,
-    .group = 0,
-    .type = SDHI_CONTROL_TYPE_ENUMERATION,
-    .configuration.enumeration = {
-      .values = sound_values,
-      .size = sizeof(sound_values) / sizeof(shdi_control_type_enumeration_value_t),
-      .initial = 0
-    }
-  },
-  {
-    .id = VOLUME,
-    .title = volume_title,
-    .group = 1,
-    .type = SDHI_CONTROL_TYPE_INTEGER,
-    .configuration.integer = {
-      .min = 0,
-      .max = 127,
-      .middle = 0,
-      .initial = 100
-    }
-  },
-  {
-    .id = ATTACK,
-    .title = attack_title,
-    .group = 2,
-    .type = SDHI_CONTROL_TYPE_INTEGER,
-    .configuration.integer = {
-      .min = -64,
-      .max = 63,
-      .middle = 0,
-      .initial = 0
-    }
+#define DRUM_CONTROLS(drum, drum_name, drum_note, drum_values, drum_values_size, drum_initial) \
+  {                                                                                  \
+    .id = ID(drum, DRUM_TYPE),                                                       \
+    .title = type_title,                                                             \
+    .group = 0,                                                                      \
+    .type = SDHI_CONTROL_TYPE_ENUMERATION,                                           \
+    .configuration.enumeration = {                                                   \
+      .values = drum_values,                                                         \
+      .size = drum_values_size,                                                      \
+      .initial = drum_initial                                                        \
+    }                                                                                \
+  },                                                                                 \
+  {                                                                                  \
+    .id = ID(drum, DRUM_SOUND),                                                      \
+    .title = sound_title,                                                            \
+    .group = 0,                                                                      \
+    .type = SDHI_CONTROL_TYPE_ENUMERATION,                                           \
+    .configuration.enumeration = {                                                   \
+      .values = sound_values,                                                        \
+      .size = sizeof(sound_values) / sizeof(shdi_control_type_enumeration_value_t),  \
+      .initial = 0                                                                   \
+    }                                                                                \
+  },                                                                                 \
+  {                                                                                  \
+    .id = ID(drum, VOLUME),                                                          \
+    .title = volume_title,                                                           \
+    .group = 1,                                                                      \
+    .type = SDHI_CONTROL_TYPE_INTEGER,                                               \
+    .configuration.integer = {                                                       \
+      .min = 0,                                                                      \
+      .max = 127,                                                                    \
+      .middle = 0,                                                                   \
+      .initial = 100                                                                 \
+    }                                                                                \
+  },                                                                                 \
+  {                                                                                  \
+    .id = ID(drum, ATTACK),                                                          \
+    .title = attack_title,                                                           \
+    .group = 2,                                                                      \
+    .type = SDHI_CONTROL_TYPE_INTEGER,                                               \
+    .configuration.integer = {                                                       \
+      .min = -64,                                                                    \
+      .max = 63,                                                                     \
+      .middle = 0,                                                                   \
+      .initial = 0                                                                   \
+    }                                                                                \
+  },                                                                                 \
+  {                                                                                  \
+    .id = ID(drum, DECAY),                                                           \
+    .title = decay_title,                                                            \
+    .group = 2,                                                                      \
+    .type = SDHI_CONTROL_TYPE_INTEGER,                                               \
+    .configuration.integer = {                                                       \
+      .min = -64,                                                                    \
+      .max = 63,                                                                     \
+      .middle = 0,                                                                   \
+      .initial = 0                                                                   \
+    }                                                                                \
+  },                                                                                 \
+  {                                                                                  \
+    .id = ID(drum, RELEASE),                                                         \
+    .title = release_title,                                                          \
+    .group = 2,                                                                      \
+    .type = SDHI_CONTROL_TYPE_INTEGER,                                               \
+    .configuration.integer = {                                                       \
+      .min = -64,                                                                    \
+      .max = 63,                                                                     \
+      .middle = 0,                                                                   \
+      .initial = 0                                                                   \
+    }                                                                                \
+  },                                                                                 \
+  {                                                                                  \
+    .id = ID(drum, LPF_CUTOFF),                                                      \
+    .title = lpf_cutoff_title,                                                       \
+    .group = 3,                                                                      \
+    .type = SDHI_CONTROL_TYPE_INTEGER,                                               \
+    .configuration.integer = {                                                       \
+      .min = -64,                                                                    \
+      .max = 63,                                                                     \
+      .middle = 0,                                                                   \
+      .initial = 0                                                                   \
+    }                                                                                \
+  },                                                                                 \
+  {                                                                                  \
+    .id = ID(drum, LPF_RESONANCE),                                                   \
+    .title = lpf_resonance_title,                                                    \
+    .group = 3,                                                                      \
+    .type = SDHI_CONTROL_TYPE_INTEGER,                                               \
+    .configuration.integer = {                                                       \
+      .min = -64,                                                                    \
+      .max = 63,                                                                     \
+      .middle = 0,                                                                   \
+      .initial = 0                                                                   \
+    }                                                                                \
+  },                                                                                 \
+  {                                                                                  \
+    .id = ID(drum, HPF_CUTOFF),                                                      \
+    .title = hpf_cutoff_title,                                                       \
+    .group = 4,                                                                      \
+    .type = SDHI_CONTROL_TYPE_INTEGER,                                               \
+    .configuration.integer = {                                                       \
+      .min = -64,                                                                    \
+      .max = 63,                                                                     \
+      .middle = 0,                                                                   \
+      .initial = 0                                                                   \
+    }                                                                                \
   },
-  {
-    .id = DECAY,
-    .title = decay_title,
-    .group = 2,
-    .type = SDHI_CONTROL_TYPE_INTEGER,
-    .configuration.integer = {
-      .min = -64,
-      .max = 63,
-      .middle = 0,
-      .initial = 0
-    }
-  },
-  {
-    .id = RELEASE,
-    .title = release_title,
-    .group = 2,
-    .type = SDHI_CONTROL_TYPE_INTEGER,
-    .configuration.integer = {
-      .min = -64,
-      .max = 63,
-      .middle = 0,
-      .initial = 0
-    }
-  },
-  {
-    .id = LPF_CUTOFF,
-    .title = lpf_cutoff_title,
-    .group = 3,
-    .type = SDHI_CONTROL_TYPE_INTEGER,
-    .configuration.integer = {
-      .min = -64,
-      .max = 63,
-      .middle = 0,
-      .initial = 0
-    }
-  },
-  {
-    .id = LPF_RESONANCE,
-    .title = lpf_resonance_title,
-    .group = 3,
-    .type = SDHI_CONTROL_TYPE_INTEGER,
-    .configuration.integer = {
-      .min = -64,
-      .max = 63,
-      .middle = 0,
-      .initial = 0
-    }
-  },
-  {
-    .id = HPF_CUTOFF,
-    .title = hpf_cutoff_title,
-    .group = 4,
-    .type = SDHI_CONTROL_TYPE_INTEGER,
-    .configuration.integer = {
-      .min = -64,
-      .max = 63,
-      .middle = 0,
-      .initial = 0
-    }
-  }
-};
-static const uint32_t controls_template_size = sizeof(controls_template) / sizeof(sdhi_control_t);
 
-static sdhi_control_t controls[(sizeof(controls_template) / sizeof(sdhi_control_t)) * NUMBER_OF_DRUMS];
+#define X(...) DRUM_CONTROLS(__VA_ARGS__)
+static const sdhi_control_t controls[] = {
+  DRUMS(X)
+};
+#undef X
 static const uint32_t controls_size = sizeof(controls) / sizeof(sdhi_control_t);
 
 static const sdhi_group_t * const groups = NULL;
 static const char panel_sound[] = "Sound";
 static const char panel_filter[] = "Filter";
 
-static const sdhi_panel_t const panels_template[] = {
-  {
-    panel_sound,
-    NULL,
-    {
-      NONE,    NONE,  DRUM_SOUND,
-      ATTACK,  DECAY, DRUM_TYPE,
-      RELEASE, VOLUME
-    }
+#define DRUM_PANELS(drum, drum_name, drum_note, drum_values, drum_values_size, drum_initial) \
+  {                                                                         \
+    panel_sound,                                                            \
+    drum_name,                                                              \
+    {                                                                       \
+      NONE,              NONE,            ID(drum, DRUM_SOUND),             \
+      ID(drum, ATTACK),  ID(drum, DECAY), ID(drum, DRUM_TYPE),              \
+      ID(drum, RELEASE), ID(drum, VOLUME)                                   \
+    }                                                                       \
+  },                                                                        \
+  {                                                                         \
+    panel_filter,                                                           \
+    drum_name,                                                              \
+    {                                                                       \
+      ID(drum, LPF_CUTOFF), ID(drum, LPF_RESONANCE), ID(drum, HPF_CUTOFF),  \
+      NONE,                 NONE,                    NONE,                  \
+      NONE,                 NONE                                            \
+    }                                                                       \
   },
-  {
-    panel_filter,
-    NULL,
-    {
-      LPF_CUTOFF, LPF_RESONANCE, HPF_CUTOFF,
-      NONE,       NONE,          NONE,
-      NONE,       NONE
-    }
-  }
+
+#define X(...) DRUM_PANELS(__VA_ARGS__)
+static const sdhi_panel_t panels[] = {
+  DRUMS(X)
 };
-static const uint32_t panels_template_size = sizeof(panels_template) / sizeof(sdhi_panel_t);
-static sdhi_panel_t panels[(sizeof(panels_template) / sizeof(sdhi_panel_t)) * NUMBER_OF_DRUMS];
+#undef X
 static const uint32_t panels_size = sizeof(panels) / sizeof(sdhi_panel_t);
 
-static void copy() {
-  for(uint8_t i = 0; i < NUMBER_OF_DRUMS; i++) {
-    sdhi_control_t *current_controls = controls + controls_template_size * i;
-    sdhi_panel_t *current_panels = panels + panels_template_size * i;
-    memcpy(current_controls, controls_template, sizeof(controls_template));
-
-    current_controls[0].configuration.enumeration.values = drums[i].values;
-    current_controls[0].configuration.enumeration.size = drums[i].values_size;
-    current_controls[0].configuration.enumeration.initial = drums[i].initial;
-
-    for(uint8_t j = 0; j < controls_template_size; j++) {
-      current_controls[j].id = controls_template_size * i + current_controls[j].id;
-    }
-    memcpy(current_panels, panels_template, sizeof(panels_template));
-    for(uint8_t j = 0; j < panels_template_size; j++) {
-      current_panels[j].subtitle = drums[i].name;
-      for(uint8_t k = 0; k < 8; k++) {
-        if(current_panels[j].controls[k] != NONE) {
-          current_panels[j].controls[k] = controls_template_size * i + current_panels[j].controls[k];
-        }
-      }
-    }
-  }
-}
-
 static sdhi_t sdhi = {
   controls,
   controls_size,
@@ -371,238 +293,218 @@ static sdhi_t sdhi = {
 
 static int32_t values[CONTROLS * NUMBER_OF_DRUMS];
 
-static action_t actions_template[] = {
-  {
-    .channel = 0,
-    .type = ACTION_XG_PARAMETER_CHANGE_1,
-    .configuration.xg_parameter_change = {
-      .parameter = {
-        .parameter.value = 0x07,
-        .type = PARAMETER_VALUE
-      },
-      .value = {
-        .parameter.value = 0x01,
-        .type = PARAMETER_VALUE
-      }
-    }
-  },
-  {
-    .channel = 0,
-    .type = ACTION_MAPPING,
-    .configuration.mapping = {
-      .value = {
-        .parameter.control = {
-          .id = DRUM_TYPE,
-          .offset = 0
-        },
-        .type = PARAMETER_CONTROL
-      }
-    }
-  },
-  {
-    .channel = 0,
-    .type = ACTION_BANK_CHANGE,
-    .configuration.bank_change = {
-      .value = {
-        .parameter.control = {
-          .id = DRUM_SOUND,
-          .offset = 0
-        },
-        .type = PARAMETER_CONTROL
-      }
-    }
-  },
-  {
-    .channel = 0,
-    .type = ACTION_CONTROLLER,
-    .configuration.controller = {
-      .number = {
-        .parameter.value = 7,
-        .type = PARAMETER_VALUE
-      },
-      .value = {
-        .parameter.control = {
-          .id = VOLUME,
-          .offset = 0,
-        },
-        .type = PARAMETER_CONTROL
-      }
-    }
-  },
-  {
-    .channel = 0,
-    .type = ACTION_CONTROLLER,
-    .configuration.controller = {
-      .number = {
-        .parameter.value = 73,
-        .type = PARAMETER_VALUE
-      },
-      .value = {
-        .parameter.control = {
-          .id = ATTACK,
-          .offset = 64
-        },
-        .type = PARAMETER_CONTROL
-      }
-    }
-  },
-  {
-    .channel = 0,
-    .type = ACTION_NRPN,
-    .configuration.rpn = {
-      .msb = {
-        .parameter.value = 0x01,
-        .type = PARAMETER_VALUE
-      },
-      .lsb = {
-        .parameter.value = 0x64,
-        .type = PARAMETER_VALUE
-      },
-      .value = {
-        .parameter.control = {
-          .id = DECAY,
-          .offset = 64,
-        },
-        .type = PARAMETER_CONTROL
-      }
-    }
-  },
-  {
-    .channel = 0,
-    .type = ACTION_CONTROLLER,
-    .configuration.controller = {
-      .number = {
-        .parameter.value = 72,
-        .type = PARAMETER_VALUE
-      },
-      .value = {
-        .parameter.control = {
-          .id = RELEASE,
-          .offset = 64,
-        },
-        .type = PARAMETER_CONTROL
-      }
-    }
-  },
-  {
-    .channel = 0,
-    .type = ACTION_NRPN,
-    .configuration.rpn = {
-      .msb = {
-        .parameter.value = 0x01,
-        .type = PARAMETER_VALUE
-      },
-      .lsb = {
-        .parameter.value = 0x20,
-        .type = PARAMETER_VALUE
-      },
-      .value = {
-        .parameter.control = {
-          .id = LPF_CUTOFF,
-          .offset = 64,
-        },
-        .type = PARAMETER_CONTROL
-      }
-    }
-  },
-  {
-    .channel = 0,
-    .type = ACTION_NRPN,
-    .configuration.rpn = {
-      .msb = {
-        .parameter.value = 0x01,
-        .type = PARAMETER_VALUE
-      },
-      .lsb = {
-        .parameter.value = 0x21,
-        .type = PARAMETER_VALUE
-      },
-      .value = {
-        .parameter.control = {
-          .id = LPF_RESONANCE,
-          .offset = 64
-        },
-        .type = PARAMETER_CONTROL
-      }
-    }
-  },
-  {
-    .channel = 0,
-    .type = ACTION_NRPN,
-    .configuration.rpn = {
-      .msb = {
-        .parameter.value = 0x01,
-        .type = PARAMETER_VALUE
-      },
-      .lsb = {
-        .parameter.value = 0x24,
-        .type = PARAMETER_VALUE
-      },
-      .value = {
-        .parameter.control = {
-          .id = HPF_CUTOFF,
-          .offset = 64,
-        },
-        .type = PARAMETER_CONTROL
-      }
-    }
-  }
-};
-static uint8_t actions_template_size = sizeof(actions_template) / sizeof(action_t);
-static action_t actions[(sizeof(actions_template) / sizeof(action_t)) * NUMBER_OF_DRUMS];
-static uint8_t actions_size = sizeof(actions) / sizeof(action_t);
+// Drum notes and sound parameters can be sent on different ports so that
+// a burst of parameter changes doesn't delay the notes
+#define NOTE_PORT MIDI_PORT_DIN
+#define PARAMETER_PORT MIDI_PORT_DIN
+// Channel the drum notes are played on, MIDI channel 1
+#define NOTE_IN_CHANNEL 0
 
-parameter_t parameter_config(parameter_t parameter, const uint32_t offset) {
-  if(parameter.type == PARAMETER_CONTROL) {
-    parameter.parameter.control.id = parameter.parameter.control.id + offset;
-  }
-  return parameter;
-}
-
-void copy_actions() {
-  for(uint8_t i = 0; i < NUMBER_OF_DRUMS; i++) {
-    action_t * current_actions = actions + actions_template_size * i;
+#define DRUM_ACTIONS(drum, drum_name, drum_note, drum_values, drum_values_size, drum_initial) \
+  {                                         \
+    .port = PARAMETER_PORT,                 \
+    .channel = drum,                        \
+    .type = ACTION_XG_PARAMETER_CHANGE_1,   \
+    .configuration.xg_parameter_change = {  \
+      .parameter = {                        \
+        .parameter.value = 0x07,            \
+        .type = PARAMETER_VALUE             \
+      },                                    \
+      .value = {                            \
+        .parameter.value = 0x01,            \
+        .type = PARAMETER_VALUE             \
+      }                                     \
+    }                                       \
+  },                                        \
+  {                                         \
+    .port = NOTE_PORT,                      \
+    .channel = drum,                        \
+    .type = ACTION_MAPPING,                 \
+    .configuration.mapping = {              \
+      .note = {                             \
+        .parameter.value = drum_note,       \
+        .type = PARAMETER_VALUE             \
+      },                                    \
+      .value = {                            \
+        .parameter.control = {              \
+          .id = ID(drum, DRUM_TYPE),        \
+          .offset = 0                       \
+        },                                  \
+        .type = PARAMETER_CONTROL           \
+      },                                    \
+      .in_channel = {                       \
+        .parameter.value = NOTE_IN_CHANNEL, \
+        .type = PARAMETER_VALUE             \
+      }                                     \
+    }                                       \
+  },                                        \
+  {                                         \
+    .port = PARAMETER_PORT,                 \
+    .channel = drum,                        \
+    .type = ACTION_BANK_CHANGE,             \
+    .configuration.bank_change = {          \
+      .value = {                            \
+        .parameter.control = {              \
+          .id = ID(drum, DRUM_SOUND),       \
+          .offset = 0                       \
+        },                                  \
+        .type = PARAMETER_CONTROL           \
+      }                                     \
+    }                                       \
+  },                                        \
+  {                                         \
+    .port = PARAMETER_PORT,                 \
+    .channel = drum,                        \
+    .type = ACTION_CONTROLLER,              \
+    .configuration.controller = {           \
+      .number = {                           \
+        .parameter.value = 7,               \
+        .type = PARAMETER_VALUE             \
+      },                                    \
+      .value = {                            \
+        .parameter.control = {              \
+          .id = ID(drum, VOLUME),           \
+          .offset = 0,                      \
+        },                                  \
+        .type = PARAMETER_CONTROL           \
+      }                                     \
+    }                                       \
+  },                                        \
+  {                                         \
+    .port = PARAMETER_PORT,                 \
+    .channel = drum,                        \
+    .type = ACTION_CONTROLLER,              \
+    .configuration.controller = {           \
+      .number = {                           \
+        .parameter.value = 73,              \
+        .type = PARAMETER_VALUE             \
+      },                                    \
+      .value = {                            \
+        .parameter.control = {              \
+          .id = ID(drum, ATTACK),           \
+          .offset = 64                      \
+        },                                  \
+        .type = PARAMETER_CONTROL           \
+      }                                     \
+    }                                       \
+  },                                        \
+  {                                         \
+    .port = PARAMETER_PORT,                 \
+    .channel = drum,                        \
+    .type = ACTION_NRPN,                    \
+    .configuration.rpn = {                  \
+      .msb = {                              \
+        .parameter.value = 0x01,            \
+        .type = PARAMETER_VALUE             \
+      },                                    \
+      .lsb = {                              \
+        .parameter.value = 0x64,            \
+        .type = PARAMETER_VALUE             \
+      },                                    \
+      .value = {                            \
+        .parameter.control = {              \
+          .id = ID(drum, DECAY),            \
+          .offset = 64,                     \
+        },                                  \
+        .type = PARAMETER_CONTROL           \
+      }                                     \
+    }                                       \
+  },                                        \
+  {                                         \
+    .port = PARAMETER_PORT,                 \
+    .channel = drum,                        \
+    .type = ACTION_CONTROLLER,              \
+    .configuration.controller = {           \
+      .number = {                           \
+        .parameter.value = 72,              \
+        .type = PARAMETER_VALUE             \
+      },                                    \
+      .value = {                            \
+        .parameter.control = {              \
+          .id = ID(drum, RELEASE),          \
+          .offset = 64,                     \
+        },                                  \
+        .type = PARAMETER_CONTROL           \
+      }                                     \
+    }                                       \
+  },                                        \
+  {                                         \
+    .port = PARAMETER_PORT,                 \
+    .channel = drum,                        \
+    .type = ACTION_NRPN,                    \
+    .configuration.rpn = {                  \
+      .msb = {                              \
+        .parameter.value = 0x01,            \
+        .type = PARAMETER_VALUE             \
+      },                                    \
+      .lsb = {                              \
+        .parameter.value = 0x20,            \
+        .type = PARAMETER_VALUE             \
+      },                                    \
+      .value = {                            \
+        .parameter.control = {              \
+          .id = ID(drum, LPF_CUTOFF),       \
+          .offset = 64,                     \
+        },                                  \
+        .type = PARAMETER_CONTROL           \
+      }                                     \
+    }                                       \
+  },                                        \
+  {                                         \
+    .port = PARAMETER_PORT,                 \
+    .channel = drum,                        \
+    .type = ACTION_NRPN,                    \
+    .configuration.rpn = {                  \
+      .msb = {                              \
+        .parameter.value = 0x01,            \
+        .type = PARAMETER_VALUE             \
+      },                                    \
+      .lsb = {                              \
+        .parameter.value = 0x21,            \
+        .type = PARAMETER_VALUE             \
+      },                                    \
+      .value = {                            \
+        .parameter.control = {              \
+          .id = ID(drum, LPF_RESONANCE),    \
+          .offset = 64                      \
+        },                                  \
+        .type = PARAMETER_CONTROL           \
+      }                                     \
+    }                                       \
+  },                                        \
+  {                                         \
+    .port = PARAMETER_PORT,                 \
+    .channel = drum,                        \
+    .type = ACTION_NRPN,                    \
+    .configuration.rpn = {                  \
+      .msb = {                              \
+        .parameter.value = 0x01,            \
+        .type = PARAMETER_VALUE             \
+      },                                    \
+      .lsb = {                              \
+        .parameter.value = 0x24,            \
+        .type = PARAMETER_VALUE             \
+      },                                    \
+      .value = {                            \
+        .parameter.control = {              \
+          .id = ID(drum, HPF_CUTOFF),       \
+          .offset = 64,                     \
+        },                                  \
+        .type = PARAMETER_CONTROL           \
+      }                                     \
+    }                                       \
+  },
 
-    memcpy(current_actions, actions_template, sizeof(actions_template));
-    current_actions[1].configuration.mapping.note.parameter.value = drums[i].note;
-    current_actions[1].configuration.mapping.note.type = PARAMETER_VALUE;
-    for(uint8_t j = 0; j < actions_template_size; j++) {
-      switch(current_actions[j].type) {
-      case ACTION_CONTROLLER:
-        current_actions[j].configuration.controller.number =
-          parameter_config(current_actions[j].configuration.controller.number, controls_template_size * i);
-        current_actions[j].configuration.controller.value =
-          parameter_config(current_actions[j].configuration.controller.value, controls_template_size * i);
-        break;
-      case ACTION_NRPN:
-        current_actions[j].configuration.rpn.msb =
-          parameter_config(current_actions[j].configuration.rpn.msb, controls_template_size * i);
-        current_actions[j].configuration.rpn.lsb =
-          parameter_config(current_actions[j].configuration.rpn.lsb, controls_template_size * i);
-        current_actions[j].configuration.rpn.value =
-          parameter_config(current_actions[j].configuration.rpn.value, controls_template_size * i);
-        break;
-      case ACTION_BANK_CHANGE:
-        current_actions[j].configuration.bank_change.value =
-          parameter_config(current_actions[j].configuration.bank_change.value, controls_template_size * i);
-        break;
-      case ACTION_MAPPING:
-        current_actions[j].configuration.mapping.note =
-          parameter_config(current_actions[j].configuration.mapping.note, controls_template_size * i);
-        current_actions[j].configuration.mapping.value =
-          parameter_config(current_actions[j].configuration.mapping.value, controls_template_size * i);
-        break;
-      }
-      current_actions[j].channel = i;
-    }
-  }
-}
+#define X(...) DRUM_ACTIONS(__VA_ARGS__)
+static const action_t actions[] = {
+  DRUMS(X)
+};
+#undef X
+static const uint8_t actions_size = sizeof(actions) / sizeof(action_t);
 
 static action_value_t action_values[sizeof(actions) / sizeof(action_t)];
 
 setup_t drum_init() {
-  copy();
-  copy_actions();
   setup_t drum = {
     .sdhi = sdhi,
     .values = values,
@@ -0,0 +1,79 @@
+#include "format.h"
+#include "hot_path.h"
+
+static const uint32_t decimal_scale[] HOT_DATA("format") = {
+  1, 10, 100, 1000, 10000, 100000, 1000000, 10000000, 100000000, 1000000000
+};
+
+static uint32_t magnitude(const int32_t value) {
+  return value < 0 ? -(uint32_t)value : (uint32_t)value;
+}
+
+uint8_t HOT_PATH(format_unsigned)(uint8_t * const glyphs, uint32_t value) {
+  uint8_t digits[10];
+  uint8_t size = 0;
+  do {
+    digits[size++] = '0' + value % 10;
+    value /= 10;
+  } while(value != 0);
+  for(uint8_t i = 0; i < size; i++) {
+    glyphs[i] = digits[size - 1 - i];
+  }
+  return size;
+}
+
+// Minus sign only for negative values, like "%d"
+uint8_t HOT_PATH(format_integer)(uint8_t * const glyphs, const int32_t value) {
+  uint8_t i = 0;
+  if(value < 0) {
+    glyphs[i++] = '-';
+  }
+  return i + format_unsigned(glyphs + i, magnitude(value));
+}
+
+// Always a sign slot, so centered values do not jump when crossing zero
+uint8_t HOT_PATH(format_signed)(uint8_t * const glyphs, const int32_t value) {
+  if(value < 0) {
+    glyphs[0] = '-';
+  } else if(value > 0) {
+    glyphs[0] = '+';
+  } else {
+    glyphs[0] = ' ';
+  }
+  return 1 + format_unsigned(glyphs + 1, magnitude(value));
+}
+
+// Value is in units of 10^-decimals, e.g. 1234 with 2 decimals is "12.34"
+uint8_t HOT_PATH(format_fixed)(uint8_t * const glyphs, const int32_t value, const uint8_t decimals) {
+  if(decimals == 0 || decimals >= sizeof(decimal_scale) / sizeof(*decimal_scale)) {
+    return format_integer(glyphs, value);
+  }
+  const uint32_t scale = decimal_scale[decimals];
+  uint32_t fraction = magnitude(value) % scale;
+  uint8_t i = 0;
+  if(value < 0) {
+    glyphs[i++] = '-';
+  }
+  i += format_unsigned(glyphs + i, magnitude(value) / scale);
+  glyphs[i++] = '.';
+  for(uint8_t j = decimals; j > 0; j--) {
+    glyphs[i + j - 1] = '0' + fraction % 10;
+    fraction /= 10;
+  }
+  return i + decimals;
+}
+
+// Moves the glyphs to the end of a field of width glyphs, padding with spaces
+uint8_t HOT_PATH(format_right_align)(uint8_t * const glyphs, const uint8_t size, const uint8_t width) {
+  if(size >= width) {
+    return size;
+  }
+  const uint8_t padding = width - size;
+  for(uint8_t i = size; i > 0; i--) {
+    glyphs[i - 1 + padding] = glyphs[i - 1];
+  }
+  for(uint8_t i = 0; i < padding; i++) {
+    glyphs[i] = ' ';
+  }
+  return width;
+}
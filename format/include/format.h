@@ -0,0 +1,15 @@
+#pragma once
+#include "pico/stdlib.h"
+
+// Formatters writing glyph indices (character codes of the built in
+// fonts) directly into a buffer, returning the number of glyphs written.
+// No terminator is written.
+
+// Sign, 10 digits, decimal point and some decimals
+#define FORMAT_MAX_SIZE 16
+
+uint8_t format_unsigned(uint8_t * const glyphs, uint32_t value);
+uint8_t format_integer(uint8_t * const glyphs, const int32_t value);
+uint8_t format_signed(uint8_t * const glyphs, const int32_t value);
+uint8_t format_fixed(uint8_t * const glyphs, const int32_t value, const uint8_t decimals);
+uint8_t format_right_align(uint8_t * const glyphs, const uint8_t size, const uint8_t width);
@@ -0,0 +1,13 @@
+#pragma once
+#include "pico/platform.h"
+
+// Placement of the render, encoder and MIDI hot paths. With
+// SDHI_HOT_PATHS_IN_RAM they run from SRAM and their tables are copied
+// there at boot, so they never wait for XIP cache misses.
+#ifdef HOT_PATHS_IN_RAM
+#define HOT_PATH(name) __not_in_flash_func(name)
+#define HOT_DATA(group) __not_in_flash(group)
+#else
+#define HOT_PATH(name) name
+#define HOT_DATA(group)
+#endif
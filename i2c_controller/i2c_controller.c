@@ -3,6 +3,7 @@
 #include "pico/mutex.h"
 #include "hardware/i2c.h"
 #include "i2c_controller.h"
+#include "hot_path.h"
 #define I2C_SCL 5
 #define I2C_SDA 4
 #define CONTROLLERS 9
@@ -14,7 +15,7 @@ static const int addr1 = 0x21;
 static const uint8_t reg0 = 0;
 // Pin connections for pin A, B and D
 // A   B   D
-static const uint8_t controller_connections[CONTROLLERS][3] = {
+static const uint8_t controller_connections[CONTROLLERS][3] HOT_DATA("encoder") = {
   {3, 4, 5}, // E1 0xFFFFFFDF
   {10,  11,   12}, // E2 0xFFFFEFFF
   {13,  14,   15}, // E3 0xFFFF7FFF
@@ -49,7 +50,7 @@ void i2c_controller_init() {
   bi_decl(bi_2pins_with_func(I2C_SDA, I2C_SCL, GPIO_FUNC_I2C));
 }
 
-void i2c_controller_run() {
+void HOT_PATH(i2c_controller_run)() {
   i2c_write_blocking(i2c_default, addr0, &reg0, 1, true);
   i2c_read_blocking(i2c_default, addr0, (uint8_t*)&rxdata, 2, false);
   i2c_write_blocking(i2c_default, addr1, &reg0, 1, true);
@@ -72,7 +73,7 @@ void i2c_controller_run() {
   mutex_exit(&mutex);
 }
 
-bool i2c_controller_update(int32_t * const change_update) {
+bool HOT_PATH(i2c_controller_update)(int32_t * const change_update) {
   bool changed = false;
 
   mutex_enter_blocking(&mutex);
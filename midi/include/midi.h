@@ -5,6 +5,27 @@
 
 #define MIDI_EXCLUSIVE_MAX_LENGTH 16
 
+// Output ports. Drum notes go to the DIN port, the AUX and USB ports can
+// take parameter traffic so that it doesn't delay them.
+typedef enum {
+  MIDI_PORT_DIN,
+  MIDI_PORT_AUX,
+  MIDI_PORT_USB,
+  MIDI_PORTS
+} midi_port_t;
+
+// Note on velocity of a mapped note as a function of the received one
+typedef enum {
+  MIDI_VELOCITY_LINEAR,
+  // Louder at low velocities
+  MIDI_VELOCITY_SOFT,
+  // Quieter at low velocities
+  MIDI_VELOCITY_HARD,
+  MIDI_VELOCITY_CURVES
+} midi_velocity_curve_t;
+
+#define MIDI_MAPPING_TARGETS 256
+
 typedef enum {
   MIDI_CONTROLLER_MESSAGE,
   MIDI_NOTE_ON_MESSAGE,
@@ -40,11 +61,16 @@ typedef struct {
   uint8_t value;
 } rpn_message_t;
 
+// Longer messages are sent in parts queued on one port with nothing in
+// between, all but the first continued and all but the last with more to
+// follow. Mapped notes wait until the last part is sent.
 typedef struct {
   uint8_t channel;
   uint16_t manufacturer_id;
   uint8_t data[MIDI_EXCLUSIVE_MAX_LENGTH];
   uint8_t data_size;
+  bool continued;
+  bool more;
 } exclusive_message_t;
 
 typedef struct {
@@ -68,9 +94,23 @@ typedef struct {
 } midi_message_t;
 
 void midi_init();
+// Serves the inputs and ports as far as the FIFOs allow. Runs on core 1
+// at least once per byte time, 320 us at 31250 baud.
 void midi_run();
 uint32_t midi_get_available_messages(midi_message_t * messages, const uint32_t messages_size);
-uint32_t midi_can_send_messages();
-void midi_send_messages(midi_message_t * messages, const uint32_t messages_size);
-void midi_set_mapped_note(const uint8_t note, const uint8_t out_channel, const uint8_t out_note);
-void midi_clear_mapped_note(const uint8_t note);
+uint32_t midi_can_send_messages(const midi_port_t port);
+// Nothing queued or being sent on the DIN and AUX ports and no message
+// partially received on the DIN input. USB doesn't count, a host that
+// stops reading must not hold off flash writes.
+bool midi_idle();
+// Nothing queued or being sent on the port
+bool midi_port_idle(const midi_port_t port);
+void midi_send_messages(const midi_port_t port, midi_message_t * messages, const uint32_t messages_size);
+// Sends the null parameter held back after the last (N)RPN sent on each
+// port, call after a burst of messages
+void midi_flush();
+// A note received on in_channel is also sent to every target mapped to
+// it, e.g. to layer sounds. Targets are numbered by the caller, setting
+// a target again moves it.
+void midi_set_mapped_note(const uint8_t target, const uint8_t in_channel, const uint8_t note, const midi_port_t out_port, const uint8_t out_channel, const uint8_t out_note, const midi_velocity_curve_t curve);
+void midi_clear_mapped_note(const uint8_t target);
@@ -1,213 +1,508 @@
 #include <string.h>
 #include "hardware/uart.h"
 #include "hardware/gpio.h"
+#include "hardware/sync.h"
 #include "pico/platform.h"
 #include "midi.h"
+#include "usb_midi.h"
+#include "hot_path.h"
 
 #define MIDI_NOTE_ON 0x90
 #define MIDI_NOTE_OFF 0x80
 
-#define OUT_MESSAGES_SIZE 16
-#define MAX_CONTROLLER_MESSAGES 8
+#define OUT_NOTES_SIZE 32
+
+// MIDI in and the first out port use uart1, the second out port uart0
+// which then can't be used for stdio
+#define DIN_TX 8
+#define DIN_RX 9
+#define AUX_TX 12
+
+#define MIDI_CHANNELS 16
+#define MIDI_NOTES 128
+#define NO_TARGET 0xFFFF
+#define NO_KEY 0xFFFF
 
 typedef struct {
   uint8_t note;
   uint8_t channel;
+  uint8_t port;
+  uint8_t curve;
+  // Received channel and note the target is mapped from, NO_KEY if the
+  // target is not mapped
+  uint16_t key;
+  // Next target of the same key
+  uint16_t next;
 } midi_mapped_note_t;
 
-static uint8_t in_buffer[3];
-static uint8_t in_position;
+// Messages are parsed separately for every input so that running status
+// and partial messages of one don't corrupt the other
+typedef struct {
+  // Status byte followed by the data bytes received so far
+  uint8_t buffer[3];
+  uint8_t position;
+} input_t;
+
+static input_t din_in;
+static input_t usb_in;
 static queue_t in;
 
 // Exclusive start + manufacturer id + max sysex data + exclusive end
-static uint8_t out_buffer[1 + 3 + MIDI_EXCLUSIVE_MAX_LENGTH + 1];
-static uint16_t out_position;
-static uint8_t out_size;
-static queue_t out;
+#define OUT_BUFFER_SIZE (1 + 3 + MIDI_EXCLUSIVE_MAX_LENGTH + 1)
+// Status byte + (N)RPN null parameter
+#define NULL_RECORD_SIZE 5
+// Largest record with its length byte and the null parameter that may
+// have to go in front of it
+#define MAX_RECORD_SIZE (1 + OUT_BUFFER_SIZE + 1 + NULL_RECORD_SIZE)
+// Power of two so that the free running positions wrap cleanly
+#define OUT_RING_SIZE 512
+
+// Messages are serialized on core 0 straight into a ring of bytes per
+// port that core 1 only drains. Core 0 only moves head and core 1 only
+// moves tail, so the ring needs no lock. Every message is a record: a
+// length byte followed by the bytes on the wire, status byte included.
+typedef struct {
+  uint8_t bytes[OUT_RING_SIZE];
+  volatile uint32_t head;
+  volatile uint32_t tail;
+} ring_t;
+
+// Every output port has its own ring and sends its bytes independently
+// of the others, so slow traffic on one port never delays another.
+typedef struct {
+  // NULL for the USB port
+  uart_inst_t * uart;
+  ring_t ring;
+
+  // Core 0 only. (N)RPN parameter left selected by the last message,
+  // its null parameter is sent before the next message unless that is
+  // another one on the same channel, or by midi_flush.
+  bool rpn_selected;
+  midi_message_type_t selected_type;
+  rpn_message_t selected_rpn;
+
+  // Core 1 only. Bytes left of the record being sent.
+  uint8_t remaining;
+  bool record_start;
+  // Mapped notes from core 1, sent between records but never within a
+  // system exclusive message sent in parts
+  midi_message_t notes[OUT_NOTES_SIZE];
+  uint8_t notes_first;
+  uint8_t notes_size;
+  uint8_t note[3];
+  uint8_t note_position;
+  uint8_t note_size;
+  bool in_exclusive;
+  // Status byte of the last channel message, omitted from the next one
+  // while messages are sent back to back. 0 when the port is idle.
+  uint8_t running_status;
+} port_t;
+
+static port_t ports[MIDI_PORTS];
 
-static void read_note(midi_message_type_t type, midi_message_t *midi) {
+static void HOT_PATH(read_note)(const input_t * const input, midi_message_type_t type, midi_message_t *midi) {
   note_message_t midi_note = {
-    in_buffer[0] & 0x0F,
-    in_buffer[1] & 0x7F,
-    in_buffer[2] & 0x7F
+    input->buffer[0] & 0x0F,
+    input->buffer[1] & 0x7F,
+    input->buffer[2] & 0x7F
   };
   midi->type = type;
   midi->value.note = midi_note;
 }
 
-static void write_size(uint8_t size) {
-  out_size = size;
-  out_position = 0;
+static uint32_t ring_free(const ring_t * const ring) {
+  return OUT_RING_SIZE - (ring->head - ring->tail);
+}
+
+// Waits for core 1 to make room, callers check midi_can_send_messages
+// first so this normally never spins
+static void ring_write(ring_t * const ring, const uint8_t * const bytes, const uint8_t size) {
+  while(ring_free(ring) < 1u + size) {
+    tight_loop_contents();
+  }
+  const uint32_t head = ring->head;
+  ring->bytes[head % OUT_RING_SIZE] = size;
+  for(uint8_t i = 0; i < size; i++) {
+    ring->bytes[(head + 1 + i) % OUT_RING_SIZE] = bytes[i];
+  }
+  // The record must be complete before core 1 sees the new head
+  __dmb();
+  ring->head = head + 1u + size;
 }
 
-static void write_note(const note_message_t note_on, uint8_t status_prefix) {
-  out_buffer[0] = status_prefix + (note_on.channel & 0x0F);
-  out_buffer[1] = note_on.note & 0x7F;
-  out_buffer[2] = note_on.velocity &0x7F;
-  write_size(3);
+static void write_rpn_null(port_t * const port) {
+  if(!port->rpn_selected) {
+    return;
+  }
+  const bool nrpn = port->selected_type == MIDI_NRPN_MESSAGE;
+  const uint8_t record[NULL_RECORD_SIZE] = {
+    0xB0 + (port->selected_rpn.channel & 0x0F),
+    nrpn ? 99 : 101, 127,
+    nrpn ? 98 : 100, 127
+  };
+  ring_write(&port->ring, record, NULL_RECORD_SIZE);
+  port->rpn_selected = false;
 }
 
-static void write_controller(const controller_message_t controller) {
-  out_buffer[0] = 0xB0 + (controller.channel & 0x0F);
-  out_buffer[1] = controller.number & 0x7F;
-  out_buffer[2] = controller.value & 0x7F;
-  write_size(3);
+static void write_note(port_t * const port, const note_message_t note_on, uint8_t status_prefix) {
+  const uint8_t record[3] = {
+    status_prefix + (note_on.channel & 0x0F),
+    note_on.note & 0x7F,
+    note_on.velocity & 0x7F
+  };
+  ring_write(&port->ring, record, 3);
 }
 
-static void write_program_change(const program_message_t program) {
-  out_buffer[0] = 0xC0 + (program.channel & 0x0F);
-  out_buffer[1] = program.number & 0x7F;
-  write_size(2);
+static void write_controller(port_t * const port, const controller_message_t controller) {
+  const uint8_t record[3] = {
+    0xB0 + (controller.channel & 0x0F),
+    controller.number & 0x7F,
+    controller.value & 0x7F
+  };
+  ring_write(&port->ring, record, 3);
 }
 
-static void write_rpn(const rpn_message_t rpn, uint8_t msb_cc, uint8_t lsb_cc) {
-    out_buffer[0] = 0xB0 + (rpn.channel & 0x0F);
-    out_buffer[1] = msb_cc;
-    out_buffer[2] = rpn.msb & 0x7F;
-    out_buffer[3] = lsb_cc;
-    out_buffer[4] = rpn.lsb & 0x7F;
-    out_buffer[5] = 6;
-    out_buffer[6] = rpn.value & 0x7F;
-    out_buffer[7] = msb_cc;
-    out_buffer[8] = 127;
-    out_buffer[9] = lsb_cc;
-    out_buffer[10] = 127;
-    return write_size(11);
+static void write_program_change(port_t * const port, const program_message_t program) {
+  const uint8_t record[2] = {
+    0xC0 + (program.channel & 0x0F),
+    program.number & 0x7F
+  };
+  ring_write(&port->ring, record, 2);
 }
 
-static void write_exclusive(const exclusive_message_t exclusive) {
-  out_buffer[0] = 0xF0;
-  uint8_t i;
-  if(exclusive.manufacturer_id & 0xFF00 != 0) {
-    out_buffer[1] = 0;
-    out_buffer[2] = (exclusive.manufacturer_id >> 8) & 0xFF;
-    out_buffer[3] = exclusive.manufacturer_id & 0xFF;
-    i = 4;
-  } else {
-    out_buffer[1] = exclusive.manufacturer_id & 0xFF;
-    i = 2;
+// Parameters with the same MSB sent back to back on a channel only send
+// the LSB and value, and the null parameter is only sent after the last.
+static void write_rpn(port_t * const port, const midi_message_type_t type, const rpn_message_t rpn, uint8_t msb_cc, uint8_t lsb_cc) {
+  const bool selected = port->rpn_selected && port->selected_type == type && port->selected_rpn.channel == rpn.channel;
+  if(!selected) {
+    write_rpn_null(port);
+  }
+  uint8_t record[7];
+  uint8_t i = 0;
+  record[i++] = 0xB0 + (rpn.channel & 0x0F);
+  if(!selected || port->selected_rpn.msb != rpn.msb) {
+    record[i++] = msb_cc;
+    record[i++] = rpn.msb & 0x7F;
   }
-  memcpy(out_buffer + i, exclusive.data, exclusive.data_size);
-  out_buffer[i + exclusive.data_size] = 0xF7;
-  write_size(i + exclusive.data_size + 1);
+  if(!selected || port->selected_rpn.msb != rpn.msb || port->selected_rpn.lsb != rpn.lsb) {
+    record[i++] = lsb_cc;
+    record[i++] = rpn.lsb & 0x7F;
+  }
+  record[i++] = 6;
+  record[i++] = rpn.value & 0x7F;
+  ring_write(&port->ring, record, i);
+  port->rpn_selected = true;
+  port->selected_type = type;
+  port->selected_rpn = rpn;
 }
 
-static void write_raw(const raw_message_t raw) {
-  out_buffer[0] = raw.x;
-  out_buffer[1] = raw.y;
-  out_buffer[2] = raw.z;
-  write_size(3);
+static void write_exclusive(port_t * const port, const exclusive_message_t exclusive) {
+  uint8_t record[OUT_BUFFER_SIZE];
+  uint8_t i = 0;
+  if(!exclusive.continued) {
+    record[i++] = 0xF0;
+    if((exclusive.manufacturer_id & 0xFF00) != 0) {
+      record[i++] = 0;
+      record[i++] = (exclusive.manufacturer_id >> 8) & 0xFF;
+      record[i++] = exclusive.manufacturer_id & 0xFF;
+    } else {
+      record[i++] = exclusive.manufacturer_id & 0xFF;
+    }
+  }
+  memcpy(record + i, exclusive.data, exclusive.data_size);
+  i += exclusive.data_size;
+  if(!exclusive.more) {
+    record[i++] = 0xF7;
+  }
+  ring_write(&port->ring, record, i);
 }
 
-static void write_message(const midi_message_t message) {
+static void write_raw(port_t * const port, const raw_message_t raw) {
+  const uint8_t record[3] = {raw.x, raw.y, raw.z};
+  ring_write(&port->ring, record, 3);
+}
+
+static void write_message(port_t * const port, const midi_message_t message) {
+  switch(message.type) {
+  case MIDI_RPN_MESSAGE:
+    write_rpn(port, message.type, message.value.rpn, 101, 100);
+    return;
+  case MIDI_NRPN_MESSAGE:
+    write_rpn(port, message.type, message.value.rpn, 99, 98);
+    return;
+  default:
+    break;
+  }
+  write_rpn_null(port);
   switch(message.type) {
   case MIDI_CONTROLLER_MESSAGE:
-    write_controller(message.value.controller);
+    write_controller(port, message.value.controller);
     return;
   case MIDI_NOTE_ON_MESSAGE:
-    write_note(message.value.note, MIDI_NOTE_ON);
+    write_note(port, message.value.note, MIDI_NOTE_ON);
     return;
   case MIDI_NOTE_OFF_MESSAGE:
-    write_note(message.value.note, MIDI_NOTE_OFF);
+    write_note(port, message.value.note, MIDI_NOTE_OFF);
     return;
   case MIDI_PROGRAM_CHANGE_MESSAGE:
-    write_program_change(message.value.program);
-    return;
-  case MIDI_RPN_MESSAGE:
-    write_rpn(message.value.rpn, 101, 100);
-    return;
-  case MIDI_NRPN_MESSAGE:
-    write_rpn(message.value.rpn, 99, 98);
+    write_program_change(port, message.value.program);
     return;
   case MIDI_EXCLUSIVE_MESSAGE:
-    write_exclusive(message.value.exclusive);
+    write_exclusive(port, message.value.exclusive);
     return;
   case MIDI_RAW_MESSAGE:
-    write_raw(message.value.raw);
+    write_raw(port, message.value.raw);
     return;
   default:
     return;
   }
 }
 
-#define MIDI_NOTES 127
+// First target of every received channel and note, so that a received
+// note finds its targets with one lookup
+static uint16_t mapping[MIDI_CHANNELS * MIDI_NOTES];
+static midi_mapped_note_t targets[MIDI_MAPPING_TARGETS];
+// Note on velocity of every curve for every received velocity
+static uint8_t velocities[MIDI_VELOCITY_CURVES][128];
 
-static midi_mapped_note_t not_mapped = {
-  .note = 0x80
-};
-static midi_mapped_note_t mapping[MIDI_NOTES];
+static void init_port(port_t * const port, uart_inst_t * const uart) {
+  port->uart = uart;
+  port->ring.head = 0;
+  port->ring.tail = 0;
+  port->rpn_selected = false;
+  port->remaining = 0;
+  port->notes_first = 0;
+  port->notes_size = 0;
+  port->note_position = 0;
+  port->note_size = 0;
+  port->in_exclusive = false;
+  port->running_status = 0;
+}
+
+static void init_uart(uart_inst_t * const uart, const uint8_t tx) {
+  uart_init(uart, 31250);
+  uart_set_format(uart, 8, 1, UART_PARITY_NONE);
+  gpio_set_function(tx, GPIO_FUNC_UART);
+}
 
 void midi_init() {
-  in_position = 0;
-  out_position = 0;
-  out_size = 0;
+  din_in.buffer[0] = 0;
+  din_in.position = 0;
+  usb_in.buffer[0] = 0;
+  usb_in.position = 0;
   queue_init(&in, sizeof(midi_message_t), 32);
-  queue_init(&out, sizeof(midi_message_t), OUT_MESSAGES_SIZE);
 
-  for(uint8_t i = 0; i < MIDI_NOTES; i++) {
-    mapping[i] = not_mapped;
+  for(uint16_t i = 0; i < MIDI_CHANNELS * MIDI_NOTES; i++) {
+    mapping[i] = NO_TARGET;
+  }
+  for(uint16_t i = 0; i < MIDI_MAPPING_TARGETS; i++) {
+    targets[i].key = NO_KEY;
+  }
+  // Velocity 0 is a note off and stays 0, any other stays above 0
+  for(uint16_t i = 0; i < 128; i++) {
+    velocities[MIDI_VELOCITY_LINEAR][i] = i;
+    velocities[MIDI_VELOCITY_SOFT][i] = 127 - (127 - i) * (127 - i) / 127;
+    velocities[MIDI_VELOCITY_HARD][i] = i == 0 ? 0 : MAX(i * i / 127, 1);
   }
 
-  uart_init(uart1, 31250);
-  uart_set_format(uart1, 8, 1, UART_PARITY_NONE);
-  gpio_set_function(8, GPIO_FUNC_UART);
-  gpio_set_function(9, GPIO_FUNC_UART);
+  init_port(&ports[MIDI_PORT_DIN], uart1);
+  init_port(&ports[MIDI_PORT_AUX], uart0);
+  init_port(&ports[MIDI_PORT_USB], NULL);
+  init_uart(uart1, DIN_TX);
+  init_uart(uart0, AUX_TX);
+  gpio_set_function(DIN_RX, GPIO_FUNC_UART);
 }
 
-void send_mapped(const midi_mapped_note_t map, const midi_message_type_t type, const uint8_t velocity) {
+// Layered notes can come in faster than a UART port sends them, the
+// notes that don't fit are dropped
+static void HOT_PATH(send_mapped)(const midi_mapped_note_t map, const midi_message_type_t type, const uint8_t velocity) {
   midi_message_t message = {
     .type = type,
     .value.note = {
       .channel = map.channel,
       .note = map.note,
-      .velocity = velocity
+      .velocity = type == MIDI_NOTE_ON_MESSAGE ? velocities[map.curve][velocity] : velocity
     }
   };
-  if(!queue_try_add(&out, &message)) {
-    panic("MIDI out queue is full!");
-  }
-}
-
-void midi_run() {
-  if(uart_is_readable(uart1)) {
-    uart_read_blocking(uart1, in_buffer + in_position, 1);
-    if(in_position == 2) {
-      midi_message_t message;
-      switch(in_buffer[0]) {
-      case MIDI_NOTE_OFF: {
-        read_note(MIDI_NOTE_OFF_MESSAGE, &message);
-        midi_mapped_note_t map = mapping[message.value.note.note];
-        if(map.note != 0x80) {
-          send_mapped(map, MIDI_NOTE_OFF_MESSAGE, message.value.note.velocity);
-        }
-        in_position = 0;
-        break;
+  port_t * const port = &ports[map.port];
+  if(port->notes_size == OUT_NOTES_SIZE) {
+    return;
+  }
+  port->notes[(port->notes_first + port->notes_size) % OUT_NOTES_SIZE] = message;
+  port->notes_size++;
+}
+
+// The walk is bounded because core 0 may relink a target while core 1
+// follows it
+static void HOT_PATH(send_targets)(const note_message_t note, const midi_message_type_t type) {
+  uint16_t target = mapping[(note.channel & 0x0F) * MIDI_NOTES + note.note];
+  for(uint16_t i = 0; target != NO_TARGET && i < MIDI_MAPPING_TARGETS; i++) {
+    const midi_mapped_note_t map = targets[target];
+    send_mapped(map, type, note.velocity);
+    target = map.next;
+  }
+}
+
+static uint8_t HOT_PATH(data_size)(const uint8_t status) {
+  switch(status & 0xF0) {
+  case 0xC0:
+  case 0xD0:
+    return 1;
+  default:
+    return 2;
+  }
+}
+
+// Messages for core 0 are dropped if it falls behind
+static void HOT_PATH(receive)(const midi_message_t message) {
+  queue_try_add(&in, &message);
+}
+
+static void HOT_PATH(read_message)(const input_t * const input) {
+  midi_message_t message;
+  switch(input->buffer[0] & 0xF0) {
+  case MIDI_NOTE_OFF:
+    read_note(input, MIDI_NOTE_OFF_MESSAGE, &message);
+    send_targets(message.value.note, MIDI_NOTE_OFF_MESSAGE);
+    return;
+  case MIDI_NOTE_ON:
+    read_note(input, MIDI_NOTE_ON_MESSAGE, &message);
+    send_targets(message.value.note, MIDI_NOTE_ON_MESSAGE);
+    return;
+  case 0xB0:
+    message.type = MIDI_CONTROLLER_MESSAGE;
+    message.value.controller.channel = input->buffer[0] & 0x0F;
+    message.value.controller.number = input->buffer[1];
+    message.value.controller.value = input->buffer[2];
+    receive(message);
+    return;
+  case 0xC0:
+    message.type = MIDI_PROGRAM_CHANGE_MESSAGE;
+    message.value.program.channel = input->buffer[0] & 0x0F;
+    message.value.program.number = input->buffer[1];
+    receive(message);
+    return;
+  }
+}
+
+// A UART only takes a byte once its TX FIFO is empty, so at most one
+// byte waits behind the one on the wire. A note queued now goes out
+// after the message in progress instead of a FIFO full of traffic.
+static bool HOT_PATH(port_writable)(const port_t * const port) {
+  return port->uart != NULL ? uart_get_hw(port->uart)->fr & UART_UARTFR_TXFE_BITS : usb_midi_writable();
+}
+
+static void HOT_PATH(port_write)(const port_t * const port, const uint8_t byte) {
+  if(port->uart != NULL) {
+    uart_putc(port->uart, byte);
+  } else {
+    usb_midi_write(byte);
+  }
+}
+
+static void HOT_PATH(send_note)(port_t * const port) {
+  const midi_message_t message = port->notes[port->notes_first];
+  port->notes_first = (port->notes_first + 1) % OUT_NOTES_SIZE;
+  port->notes_size--;
+  const uint8_t status = (message.type == MIDI_NOTE_ON_MESSAGE ? MIDI_NOTE_ON : MIDI_NOTE_OFF) + (message.value.note.channel & 0x0F);
+  uint8_t i = 0;
+  if(status != port->running_status) {
+    port->note[i++] = status;
+    port->running_status = status;
+  }
+  port->note[i++] = message.value.note.note & 0x7F;
+  port->note[i++] = message.value.note.velocity & 0x7F;
+  port->note_size = i;
+  port->note_position = 0;
+}
+
+// Keeps track of the status on the wire, for running status and to know
+// whether a note may go in
+static void HOT_PATH(sent_byte)(port_t * const port, const uint8_t byte) {
+  if(byte >= 0xF8) {
+    // Real time messages don't change the status
+  } else if(byte == 0xF0) {
+    port->running_status = 0;
+    port->in_exclusive = true;
+  } else if(byte >= 0xF0) {
+    port->running_status = 0;
+    port->in_exclusive = false;
+  } else if(byte & 0x80) {
+    port->running_status = byte;
+  }
+}
+
+// Sends until the ring is empty or the UART or USB endpoint takes no more
+static void HOT_PATH(run_port)(port_t * const port) {
+  ring_t * const ring = &port->ring;
+  for(;;) {
+    if(port->note_position < port->note_size) {
+      if(!port_writable(port)) {
+        return;
       }
-      case MIDI_NOTE_ON: {
-        read_note(MIDI_NOTE_ON_MESSAGE, &message);
-        midi_mapped_note_t map = mapping[message.value.note.note];
-        if(map.note != 0x80) {
-          send_mapped(map, MIDI_NOTE_ON_MESSAGE, message.value.note.velocity);
+      port_write(port, port->note[port->note_position]);
+      port->note_position++;
+    } else if(port->remaining == 0 && !port->in_exclusive && port->notes_size > 0) {
+      send_note(port);
+    } else if(port->remaining > 0) {
+      const uint8_t byte = ring->bytes[ring->tail % OUT_RING_SIZE];
+      // A record starting with the running status doesn't repeat it
+      const bool omitted = port->record_start && (byte & 0x80) && byte == port->running_status;
+      if(!omitted) {
+        if(!port_writable(port)) {
+          return;
         }
-        in_position = 0;
-        break;
-      }
-      default:
-        in_buffer[0] = in_buffer[1];
-        in_buffer[1] = in_buffer[2];
-        in_position = 2;
-        break;
+        port_write(port, byte);
+        sent_byte(port, byte);
       }
+      port->record_start = false;
+      port->remaining--;
+      // The byte must be read before core 0 may overwrite it
+      __dmb();
+      ring->tail++;
+    } else if(ring->tail != ring->head) {
+      __dmb();
+      port->remaining = ring->bytes[ring->tail % OUT_RING_SIZE];
+      port->record_start = true;
+      ring->tail++;
     } else {
-      in_position++;
+      port->running_status = 0;
+      return;
+    }
+  }
+}
+
+static void HOT_PATH(read_byte)(input_t * const input, const uint8_t byte) {
+  if(byte >= 0xF8) {
+    // Real time messages can appear anywhere, even within a message
+  } else if(byte & 0x80) {
+    // Channel messages set the running status, system messages clear it
+    input->buffer[0] = byte < 0xF0 ? byte : 0;
+    input->position = 0;
+  } else if(input->buffer[0] != 0) {
+    input->buffer[1 + input->position] = byte;
+    input->position++;
+    if(input->position == data_size(input->buffer[0])) {
+      read_message(input);
+      input->position = 0;
     }
-  } else if(uart_is_writable(uart1) && out_position < out_size) {
-    uart_putc(uart1, out_buffer[out_position]);
-    out_position++;
-  } else if(out_position == out_size && queue_get_level(&out) != 0) {
-    midi_message_t message;
-    queue_remove_blocking(&out, &message);
-    write_message(message);
+  }
+}
+
+void HOT_PATH(midi_run)() {
+  while(uart_is_readable(uart1)) {
+    uint8_t byte;
+    uart_read_blocking(uart1, &byte, 1);
+    read_byte(&din_in, byte);
+  }
+  usb_midi_task();
+  uint8_t bytes[3];
+  const uint8_t size = usb_midi_read(bytes);
+  for(uint8_t i = 0; i < size; i++) {
+    read_byte(&usb_in, bytes[i]);
+  }
+  for(uint8_t i = 0; i < MIDI_PORTS; i++) {
+    run_port(&ports[i]);
   }
 }
 
@@ -217,26 +512,81 @@ uint32_t midi_get_available_messages(midi_message_t * available, const uint32_t
       return i;
     }
   }
+  return available_size;
 }
 
-uint32_t midi_can_send_messages() {
-  return MIN(OUT_MESSAGES_SIZE - queue_get_level(&out), MAX_CONTROLLER_MESSAGES);
+// Worst case, every message the longest system exclusive part
+uint32_t midi_can_send_messages(const midi_port_t port) {
+  return ring_free(&ports[port].ring) / MAX_RECORD_SIZE;
 }
 
-void midi_send_messages(midi_message_t * messages, const uint32_t messages_size) {
+bool midi_port_idle(const midi_port_t i) {
+  const port_t * const port = &ports[i];
+  return port->ring.head == port->ring.tail && port->remaining == 0 && !port->rpn_selected
+    && port->notes_size == 0 && port->note_position == port->note_size;
+}
+
+// USB traffic is buffered by the host and waits out a flash write, only
+// the UARTs have to keep their timing
+bool midi_idle() {
+  for(uint8_t i = 0; i < MIDI_PORTS; i++) {
+    if(ports[i].uart != NULL && !midi_port_idle(i)) {
+      return false;
+    }
+  }
+  return din_in.position == 0;
+}
+
+void midi_send_messages(const midi_port_t port, midi_message_t * messages, const uint32_t messages_size) {
   for(uint32_t i = 0; i < messages_size; i++) {
-    queue_add_blocking(&out, messages + i);
+    write_message(&ports[port], messages[i]);
   }
 }
 
-void midi_set_mapped_note(const uint8_t note, const uint8_t out_channel, const uint8_t out_note) {
-  const midi_mapped_note_t map = {
-    .channel = out_channel,
-    .note = out_note
-  };
-  mapping[note & 0x7F] = map;
+void midi_flush() {
+  for(uint8_t i = 0; i < MIDI_PORTS; i++) {
+    write_rpn_null(&ports[i]);
+  }
+}
+
+static void unlink_target(const uint8_t target) {
+  const uint16_t key = targets[target].key;
+  if(key == NO_KEY) {
+    return;
+  }
+  if(mapping[key] == target) {
+    mapping[key] = targets[target].next;
+  } else {
+    uint16_t previous = mapping[key];
+    while(targets[previous].next != target) {
+      previous = targets[previous].next;
+    }
+    targets[previous].next = targets[target].next;
+  }
+  targets[target].key = NO_KEY;
+}
+
+void midi_set_mapped_note(const uint8_t target, const uint8_t in_channel, const uint8_t note, const midi_port_t out_port, const uint8_t out_channel, const uint8_t out_note, const midi_velocity_curve_t curve) {
+  if(curve >= MIDI_VELOCITY_CURVES) {
+    panic("No such velocity curve!");
+  }
+  const uint16_t key = (in_channel & 0x0F) * MIDI_NOTES + (note & 0x7F);
+  midi_mapped_note_t * const map = &targets[target];
+  if(map->key == key && map->port == out_port && map->channel == out_channel && map->note == out_note && map->curve == curve) {
+    return;
+  }
+  unlink_target(target);
+  map->channel = out_channel;
+  map->note = out_note;
+  map->port = out_port;
+  map->curve = curve;
+  map->key = key;
+  map->next = mapping[key];
+  // The target must be complete before core 1 can reach it
+  __dmb();
+  mapping[key] = target;
 }
 
-void midi_clear_mapped_note(const uint8_t note) {
-  mapping[note & 0x7F] = not_mapped;
+void midi_clear_mapped_note(const uint8_t target) {
+  unlink_target(target);
 }
@@ -0,0 +1,10 @@
+#pragma once
+
+// Layout of a display in the framebuffer: DISPLAY_ROWS pages of 8 pixel
+// rows, each a header selecting the page followed by one byte per
+// column, bit n of page p being y = 8 * p + n
+#define DISPLAY_WIDTH 128
+#define DISPLAY_ROW (32 * 4)
+#define DISPLAY_ROW_HEADER (3 * 4)
+#define DISPLAY_ROWS 8
+#define DISPLAY_ROW_SIZE (DISPLAY_ROW + DISPLAY_ROW_HEADER)
@@ -1,13 +1,40 @@
 #pragma once
 #include "pico/stdlib.h"
 
-typedef enum {SIZE_13 = 0, SIZE_18 = 1, SIZE_28 = 2, SIZE_32 = 3} pio_display_font_size_t;
+// Fonts in the order they are compiled, see pio_display/CMakeLists.txt
+typedef enum {SIZE_13 = 0, SIZE_18 = 1, SIZE_28 = 2} pio_display_font_size_t;
 typedef struct {
     uint8_t width;
     uint8_t height;
 } pio_display_box_t;
 
-void pio_display_init();
+#define PIO_DISPLAY_MAX_CHAINS 8
+
+// Size of the static framebuffers, two of DISPLAY_SIZE bytes per display.
+// Displays are numbered with a byte, 255 is reserved.
+#ifndef PIO_DISPLAY_MAX_DISPLAYS
+#define PIO_DISPLAY_MAX_DISPLAYS 40
+#endif
+#if PIO_DISPLAY_MAX_DISPLAYS > 254
+#error "PIO_DISPLAY_MAX_DISPLAYS must fit in a display index"
+#endif
+
+// A tile is one display in framebuffer layout, 8 pages of 128 columns
+// each after a 12 byte row header, and must be word aligned
+#define PIO_DISPLAY_TILE_SIZE (8 * (128 + 12))
+
+// One chain of displays on its own state machine and DMA channel. SHIFT_CS
+// is the pin after dc. CS and RESET are shared by all chains.
+typedef struct {
+  uint8_t mosi;
+  uint8_t dc;
+  uint8_t sclk;
+  uint8_t displays;
+} pio_display_chain_t;
+
+void pio_display_init(const uint8_t displays);
+void pio_display_init_chains(const pio_display_chain_t * const chains, const uint8_t chains_size);
+// Waits until a clear or copy of the display by DMA has finished
 uint8_t *pio_display_get(const uint8_t i);
 void pio_display_fill(uint8_t * const fb, const uint8_t pattern);
 void pio_display_clear(uint8_t * const fb);
@@ -17,9 +44,34 @@ void pio_display_fill_rectangle(uint8_t * const fb,
                                 const uint8_t endx, const uint8_t endy);
 void pio_display_printc(uint8_t * const fb, const uint8_t startx, const uint8_t starty, const pio_display_font_size_t font_size, const bool on, const char c);
 void pio_display_print(uint8_t * const fb, const uint8_t startx, const uint8_t starty, const pio_display_font_size_t font_size, const bool on, const char * const str);
-pio_display_box_t text_box(const pio_display_font_size_t font_size, const char * const str);
+void pio_display_print_glyphs(uint8_t * const fb, const uint8_t startx, const uint8_t starty, const pio_display_font_size_t font_size, const bool on, const uint8_t * const glyphs, const uint8_t size);
+// Width up to the last inked column. Text wider than a display is
+// clipped, centered text then starts at the left edge.
+pio_display_box_t pio_display_text_box(const pio_display_font_size_t font_size, const char * const str);
+pio_display_box_t pio_display_glyphs_box(const pio_display_font_size_t font_size, const uint8_t * const glyphs, const uint8_t size);
 void pio_display_print_center(uint8_t * const fb, const uint8_t y, const pio_display_font_size_t font_size, const bool on, const char * const str);
+void pio_display_print_glyphs_center(uint8_t * const fb, const uint8_t y, const pio_display_font_size_t font_size, const bool on, const uint8_t * const glyphs, const uint8_t size);
+// Clears the pixel data of all displays by DMA in the background, in
+// display order. pio_display_get waits for each display.
 void pio_display_clear_current_framebuffer();
+// Prepares a tile for drawing with the functions above, which then copies
+// into a display of the current framebuffer by DMA in the background
+void pio_display_tile_init(uint8_t * const tile);
+void pio_display_copy(const uint8_t display, const uint8_t * const tile);
 void pio_display_update_and_flip();
 void pio_display_wait_for_finish_blocking();
 bool pio_display_can_wait_without_blocking();
+// Controller commands for a single display, sent ahead of its pixel data
+// with the next frame. Scrolling moves pages start_page to end_page by
+// one column every interval (SSD1306 frame interval code 0-7) without
+// any data being sent; the display keeps showing what it showed when
+// scrolling started. Its pixel data is dropped meanwhile, so after a
+// stop it keeps scrolling until pio_display_redraw returns true for it.
+void pio_display_invert(const uint8_t display, const bool inverse);
+void pio_display_contrast(const uint8_t display, const uint8_t contrast);
+void pio_display_scroll(const uint8_t display, const bool left, const uint8_t start_page, const uint8_t end_page, const uint8_t interval);
+void pio_display_scroll_stop(const uint8_t display);
+// True once after scrolling stopped. The caller then draws the display
+// again in this and the next framebuffer, and the stop is sent with the
+// next frame.
+bool pio_display_redraw(const uint8_t display);
@@ -1,10 +1,14 @@
 #include "pico/stdlib.h"
+#include "pico/mutex.h"
 #include "stdio.h"
 #include <string.h>
 #include "hardware/pio.h"
 #include "hardware/dma.h"
+#include "hardware/sync.h"
 #include "spi.pio.h"
 #include "pio_display.h"
+#include "framebuffer.h"
+#include "hot_path.h"
 #define SCLK 18
 #define MOSI 19
 #define CS 20
@@ -12,60 +16,19 @@
 #define SHIFT_CS 22
 #define RESET 26
 
-static PIO pio;
-static uint channel;
+typedef struct {
+  PIO pio;
+  uint sm;
+  uint channel;
+  uint8_t first;
+  uint8_t displays;
+} chain_t;
 
-static uint8_t shift1[] = {
-  0x00, 0x00, 0x00, 0x02
-};
+static chain_t chains[PIO_DISPLAY_MAX_CHAINS];
+static uint8_t chains_size;
+static uint32_t channels_mask;
 
-static uint32_t shift40[] = {
-  0x00, 0x00, 0x00, 0x02,
-  0x00, 0x00, 0x00, 0x02,
-  0x00, 0x00, 0x00, 0x02,
-  0x00, 0x00, 0x00, 0x02,
-  0x00, 0x00, 0x00, 0x02,
-
-  0x00, 0x00, 0x00, 0x02,
-  0x00, 0x00, 0x00, 0x02,
-  0x00, 0x00, 0x00, 0x02,
-  0x00, 0x00, 0x00, 0x02,
-  0x00, 0x00, 0x00, 0x02,
-
-  0x00, 0x00, 0x00, 0x02,
-  0x00, 0x00, 0x00, 0x02,
-  0x00, 0x00, 0x00, 0x02,
-  0x00, 0x00, 0x00, 0x02,
-  0x00, 0x00, 0x00, 0x02,
-
-  0x00, 0x00, 0x00, 0x02,
-  0x00, 0x00, 0x00, 0x02,
-  0x00, 0x00, 0x00, 0x02,
-  0x00, 0x00, 0x00, 0x02,
-  0x00, 0x00, 0x00, 0x02,
-
-  0x00, 0x00, 0x00, 0x02,
-  0x00, 0x00, 0x00, 0x02,
-  0x00, 0x00, 0x00, 0x02,
-  0x00, 0x00, 0x00, 0x02,
-  0x00, 0x00, 0x00, 0x02,
-
-  0x00, 0x00, 0x00, 0x02,
-  0x00, 0x00, 0x00, 0x02,
-  0x00, 0x00, 0x00, 0x02,
-  0x00, 0x00, 0x00, 0x02,
-  0x00, 0x00, 0x00, 0x02,
-
-  0x00, 0x00, 0x00, 0x02,
-  0x00, 0x00, 0x00, 0x02,
-  0x00, 0x00, 0x00, 0x02,
-  0x00, 0x00, 0x00, 0x02,
-  0x00, 0x00, 0x00, 0x02,
-
-  0x00, 0x00, 0x00, 0x02,
-  0x00, 0x00, 0x00, 0x02,
-  0x00, 0x00, 0x00, 0x02,
-  0x00, 0x00, 0x00, 0x02,
+static uint8_t shift1[] = {
   0x00, 0x00, 0x00, 0x02
 };
 
@@ -81,20 +44,69 @@ static uint8_t header[] = {
   0x00, 0x20, 0x00, 0x01
 };
 
-#define DISPLAY_ROW (32 * 4)
-#define DISPLAY_ROW_HEADER (3 * 4)
-#define DISPLAY_ROWS 8
-#define DISPLAY_ROW_SIZE (DISPLAY_ROW + DISPLAY_ROW_HEADER)
-#define DISPLAY_SIZE (DISPLAY_ROW_SIZE * DISPLAY_ROWS)
-#define DISPLAYS 40
-#define FRAMEBUFFER_SIZE  DISPLAY_SIZE * DISPLAYS
+// Every display starts with a header selecting it and a few command
+// bytes. The state machine skips words of zeros without clocking the
+// displays, so unused command words cost no bus time.
+#define DISPLAY_COMMANDS (3 * 4)
+#define DISPLAY_COMMANDS_SIZE (4 + DISPLAY_COMMANDS)
+#define DISPLAY_SIZE (DISPLAY_COMMANDS_SIZE + DISPLAY_ROW_SIZE * DISPLAY_ROWS)
+#define FRAMEBUFFER_SIZE  DISPLAY_SIZE * PIO_DISPLAY_MAX_DISPLAYS
 #define FRAMEBUFFER_SIZE_32 (FRAMEBUFFER_SIZE / 4)
 
 
+static uint8_t displays;
+// Time after power on from which the displays accept data
+static uint32_t ready_time;
 static uint8_t current_framebuffer = 0;
 static uint8_t framebuffer1[FRAMEBUFFER_SIZE];
 static uint8_t framebuffer2[FRAMEBUFFER_SIZE];
 
+#define COMMAND_NOP 0xE3
+
+// Controller state set through commands, sent with the next frame
+typedef struct {
+  bool inverse;
+  uint8_t contrast;
+  bool scrolling;
+  bool scroll_left;
+  uint8_t scroll_start;
+  uint8_t scroll_end;
+  uint8_t scroll_interval;
+  bool inverse_changed;
+  bool contrast_changed;
+  bool scroll_changed;
+  // Scrolling stopped, but the pixel data dropped while it scrolled has
+  // not been drawn again yet
+  bool redraw;
+} display_state_t;
+
+static display_state_t states[PIO_DISPLAY_MAX_DISPLAYS];
+// The pixel data of a scrolling display is replaced by words of zeros,
+// for each framebuffer
+static bool held[2][PIO_DISPLAY_MAX_DISPLAYS];
+
+// Background clear and copy engine on two spare DMA channels. The data
+// channel writes one block, then chains to the control channel, which
+// loads the next destination from a NULL terminated list into the data
+// channel's write address trigger. Clearing writes the pixel data of
+// every row from a zero word around the row headers. Copying writes a
+// tile over a whole display. Display i of a job is finished once the
+// control channel has read past its entries.
+static uint engine_channel;
+static uint engine_control_channel;
+static dma_channel_config engine_clear_config;
+static dma_channel_config engine_copy_config;
+static uint32_t engine_zero;
+static uint8_t *engine_clear_lists[2][PIO_DISPLAY_MAX_DISPLAYS * DISPLAY_ROWS + 1];
+static uint8_t *engine_copy_list[2];
+// The running or last job, no displays while a job is being started
+static uint8_t * const * volatile engine_list;
+static volatile uint8_t engine_entries;
+static volatile uint8_t engine_first;
+static volatile uint8_t engine_displays;
+
+auto_init_mutex(engine_mutex);
+
 static uint dma_init(PIO pio, uint sm) {
   int channel = dma_claim_unused_channel(true);
 
@@ -111,30 +123,207 @@ static uint dma_init(PIO pio, uint sm) {
   return channel;
 }
 
-uint8_t *pio_display_get(const uint8_t i) {
-  if(current_framebuffer == 0)
-    return framebuffer1 + (i * DISPLAY_SIZE);
-  else
-    return framebuffer2 + (i * DISPLAY_SIZE);
+// Starts the same transfer on every chain at once
+static void transfer_all(const uint8_t * const data, const uint32_t words) {
+  for(uint8_t i = 0; i < chains_size; i++) {
+    dma_channel_set_read_addr(chains[i].channel, data, false);
+    dma_channel_set_trans_count(chains[i].channel, words, false);
+  }
+  dma_start_channel_mask(channels_mask);
+}
+
+// Starts each chain on its own part of the framebuffer
+static void transfer_framebuffer(const uint8_t * const framebuffer) {
+  for(uint8_t i = 0; i < chains_size; i++) {
+    dma_channel_set_read_addr(chains[i].channel, framebuffer + chains[i].first * DISPLAY_SIZE, false);
+    dma_channel_set_trans_count(chains[i].channel, (chains[i].displays * DISPLAY_SIZE) / 4, false);
+  }
+  dma_start_channel_mask(channels_mask);
+}
+
+static void engine_init() {
+  engine_channel = dma_claim_unused_channel(true);
+  engine_control_channel = dma_claim_unused_channel(true);
+
+  engine_clear_config = dma_channel_get_default_config(engine_channel);
+  channel_config_set_transfer_data_size(&engine_clear_config, DMA_SIZE_32);
+  channel_config_set_read_increment(&engine_clear_config, false);
+  channel_config_set_write_increment(&engine_clear_config, true);
+  channel_config_set_chain_to(&engine_clear_config, engine_control_channel);
+  engine_copy_config = engine_clear_config;
+  channel_config_set_read_increment(&engine_copy_config, true);
+  dma_channel_configure(engine_channel, &engine_clear_config, NULL, &engine_zero, DISPLAY_ROW / 4, false);
+
+  dma_channel_config control_config = dma_channel_get_default_config(engine_control_channel);
+  channel_config_set_transfer_data_size(&control_config, DMA_SIZE_32);
+  channel_config_set_read_increment(&control_config, true);
+  channel_config_set_write_increment(&control_config, false);
+  dma_channel_configure(engine_control_channel,
+                        &control_config,
+                        &dma_channel_hw_addr(engine_channel)->al2_write_addr_trig,
+                        NULL,
+                        1,
+                        false);
+  engine_displays = 0;
+}
+
+static bool engine_done(const uint8_t display) {
+  const uint8_t displays = engine_displays;
+  const uint8_t first = engine_first;
+  if(display < first || display >= first + displays) {
+    return true;
+  }
+  uint8_t * const * const read = (uint8_t * const *)dma_channel_hw_addr(engine_control_channel)->read_addr;
+  return read - engine_list > (display - first + 1) * engine_entries;
+}
+
+static void engine_wait() {
+  const uint8_t displays = engine_displays;
+  while(displays != 0 && !engine_done(engine_first + displays - 1)) {
+    tight_loop_contents();
+  }
+}
+
+// Called with the engine idle and engine_mutex held, after the data
+// channel has been set up. Nobody waits for the displays of the job
+// before the control channel points at its list.
+static void engine_start(uint8_t * const * const list, const uint8_t entries, const uint8_t first, const uint8_t displays) {
+  engine_displays = 0;
+  __dmb();
+  dma_channel_set_read_addr(engine_control_channel, list, false);
+  engine_list = list;
+  engine_entries = entries;
+  engine_first = first;
+  __dmb();
+  engine_displays = displays;
+  dma_channel_start(engine_control_channel);
 }
 
-void pio_display_fill(uint8_t * const fb, const uint8_t pattern) {
+static bool first_in_chain(const uint8_t display) {
+  for(uint8_t i = 0; i < chains_size; i++) {
+    if(chains[i].first == display) {
+      return true;
+    }
+  }
+  return false;
+}
+
+static void write_row_headers(uint8_t * const display) {
+  for(uint8_t j = 0; j < DISPLAY_ROWS; j++) {
+    memcpy(display + j * DISPLAY_ROW_SIZE, header, DISPLAY_ROW_HEADER);
+    display[j * DISPLAY_ROW_SIZE + 5] = 0xB0 + j;
+  }
+}
+
+// Selects the display, every display but the first of a chain shifts
+// the selection on from the one before, and sends the commands
+static void write_commands(uint8_t * const display, const uint8_t i, const uint8_t * const commands, const uint8_t size) {
+  uint8_t * const slot = display - DISPLAY_COMMANDS_SIZE;
+  const uint8_t words = (size + 3) / 4;
+  slot[0] = 0x00;
+  slot[1] = words;
+  slot[2] = 0x00;
+  slot[3] = first_in_chain(i) ? 0x00 : 0x02;
+  if(size > 0) {
+    memcpy(slot + 4, commands, size);
+  }
+  memset(slot + 4 + size, COMMAND_NOP, words * 4 - size);
+  memset(slot + 4 + words * 4, 0x00, DISPLAY_COMMANDS - words * 4);
+}
+
+// Commands for the changed state, at most DISPLAY_COMMANDS bytes
+static uint8_t state_commands(display_state_t * const state, uint8_t * const commands) {
+  uint8_t size = 0;
+  if(state->inverse_changed) {
+    commands[size++] = state->inverse ? 0xA7 : 0xA6;
+    state->inverse_changed = false;
+  }
+  if(state->contrast_changed) {
+    commands[size++] = 0x81;
+    commands[size++] = state->contrast;
+    state->contrast_changed = false;
+  }
+  if(state->scroll_changed && !state->redraw) {
+    // Scrolling must be stopped before it is set up again
+    commands[size++] = 0x2E;
+    if(state->scrolling) {
+      commands[size++] = state->scroll_left ? 0x27 : 0x26;
+      commands[size++] = 0x00;
+      commands[size++] = state->scroll_start;
+      commands[size++] = state->scroll_interval;
+      commands[size++] = state->scroll_end;
+      commands[size++] = 0x00;
+      commands[size++] = 0xFF;
+      commands[size++] = 0x2F;
+    }
+    state->scroll_changed = false;
+  }
+  return size;
+}
+
+// Prepares a display of the framebuffer about to be sent. The display
+// scrolls its own RAM, which pixel data written meanwhile would undo,
+// so the rows of a scrolling display are turned into words of zeros.
+// The display keeps scrolling until it has been drawn again, then
+// stopping the scroll is sent ahead of the rows, which rewrite the RAM
+// as required after scrolling.
+static void prepare_display(uint8_t * const display, const uint8_t i) {
+  uint8_t commands[DISPLAY_COMMANDS];
+  const uint8_t size = state_commands(&states[i], commands);
+  write_commands(display, i, commands, size);
+  if(states[i].scrolling || states[i].redraw) {
+    memset(display, 0x00, DISPLAY_ROW_SIZE * DISPLAY_ROWS);
+    held[current_framebuffer][i] = true;
+  } else if(held[current_framebuffer][i]) {
+    write_row_headers(display);
+    held[current_framebuffer][i] = false;
+  }
+}
+
+static uint8_t *display_address(const uint8_t framebuffer, const uint8_t i) {
+  return (framebuffer == 0 ? framebuffer1 : framebuffer2) + (i * DISPLAY_SIZE) + DISPLAY_COMMANDS_SIZE;
+}
+
+uint8_t *HOT_PATH(pio_display_get)(const uint8_t i) {
+  while(!engine_done(i)) {
+    tight_loop_contents();
+  }
+  return display_address(current_framebuffer, i);
+}
+
+void HOT_PATH(pio_display_fill)(uint8_t * const fb, const uint8_t pattern) {
   for(uint8_t i = 0; i < DISPLAY_ROWS; i++)
     memset(fb + i * DISPLAY_ROW_SIZE + DISPLAY_ROW_HEADER, pattern, DISPLAY_ROW);
 }
 
-void pio_display_clear(uint8_t * const fb) {
+void HOT_PATH(pio_display_clear)(uint8_t * const fb) {
   pio_display_fill(fb, 0x00);
 }
 
-void pio_display_pixel(uint8_t * const fb, const uint8_t x, const uint8_t y, const bool on) {
+void HOT_PATH(pio_display_pixel)(uint8_t * const fb, const uint8_t x, const uint8_t y, const bool on) {
     uint8_t real_y = y / 8;
     int pos = real_y * DISPLAY_ROW_SIZE + DISPLAY_ROW_HEADER + x;
     uint8_t seg = fb[pos];
     fb[pos] ^= (-on ^ seg) & (1 << (y % 8));
 }
 
-void pio_display_init() {
+void pio_display_init(const uint8_t displays) {
+  const pio_display_chain_t chain = {
+    .mosi = MOSI,
+    .dc = DC,
+    .sclk = SCLK,
+    .displays = displays
+  };
+  pio_display_init_chains(&chain, 1);
+}
+
+// Chains 0-3 run on pio0 and 4-7 on pio1. Displays are numbered
+// consecutively through the chains in the order given.
+void pio_display_init_chains(const pio_display_chain_t * const chain_configurations, const uint8_t chain_configurations_size) {
+  if(chain_configurations_size == 0 || chain_configurations_size > PIO_DISPLAY_MAX_CHAINS) {
+    panic("Unsupported number of display chains!");
+  }
+
   gpio_init(RESET);
   gpio_set_dir(RESET, GPIO_OUT);
   gpio_put(RESET, 0);
@@ -145,83 +334,199 @@ void pio_display_init() {
   gpio_set_dir(CS, GPIO_OUT);
   gpio_put(CS, 1);
 
-  pio = pio0;
-
-  uint offset = pio_add_program(pio, &spi_program);
-  uint sm = pio_claim_unused_sm(pio, true);
+  uint offsets[2];
+  uint16_t total = 0;
+  chains_size = chain_configurations_size;
+  channels_mask = 0;
+  for(uint8_t i = 0; i < chains_size; i++) {
+    const pio_display_chain_t configuration = chain_configurations[i];
+    chain_t * const chain = &chains[i];
+    chain->pio = i < NUM_PIO_STATE_MACHINES ? pio0 : pio1;
+    if(i % NUM_PIO_STATE_MACHINES == 0) {
+      offsets[i / NUM_PIO_STATE_MACHINES] = pio_add_program(chain->pio, &spi_program);
+    }
+    chain->sm = pio_claim_unused_sm(chain->pio, true);
+    spi_program_init(chain->pio, chain->sm, offsets[i / NUM_PIO_STATE_MACHINES], configuration.mosi, configuration.dc, configuration.sclk);
+    chain->channel = dma_init(chain->pio, chain->sm);
+    chain->first = total;
+    chain->displays = configuration.displays;
+    channels_mask |= 1u << chain->channel;
+    total += configuration.displays;
+  }
+  if(total == 0 || total > PIO_DISPLAY_MAX_DISPLAYS) {
+    panic("Display chains do not fit in %d displays!", PIO_DISPLAY_MAX_DISPLAYS);
+  }
+  displays = total;
+
+  engine_init();
+  for(uint8_t j = 0; j < 2; j++) {
+    uint8_t ** entry = engine_clear_lists[j];
+    for(uint8_t i = 0; i < displays; i++) {
+      for(uint8_t row = 0; row < DISPLAY_ROWS; row++) {
+        *entry++ = display_address(j, i) + row * DISPLAY_ROW_SIZE + DISPLAY_ROW_HEADER;
+      }
+    }
+    *entry = NULL;
+  }
 
-  spi_program_init(pio, sm, offset, MOSI, DC, SCLK);
+  // Initialize displays all at once
+  transfer_all(initialize, sizeof(initialize) / 4);
+  pio_display_wait_for_finish_blocking();
 
-  channel = dma_init(pio, sm);
+  // Initialize shift registers with 1s
+  for(uint8_t i = 0; i < displays; i++) {
+    transfer_all(shift1, sizeof(shift1) / 4);
+    pio_display_wait_for_finish_blocking();
+  }
 
-  // Initialize displays all at once
-  dma_channel_transfer_from_buffer_now(channel, initialize, (sizeof(initialize) / sizeof(*initialize)) / 4);
-  dma_channel_wait_for_finish_blocking(channel);
-
-  // Initialize shift register with 1s
-  dma_channel_transfer_from_buffer_now(channel, shift40, (sizeof(shift40) / sizeof(*shift40)) / 4);
-  dma_channel_wait_for_finish_blocking(channel);
-
-  // After turning on display a 100ms delay is required before writing any data
-  sleep_ms(100);
-
-  for(uint8_t i = 0; i < DISPLAYS; i++) {
-    uint8_t *display = pio_display_get(i);
-    for(uint8_t j = 0; j < DISPLAY_ROWS; j++) {
-      memcpy(display + j * DISPLAY_ROW_SIZE, header, DISPLAY_ROW_HEADER);
-      if(j == 0 && i != 0)
-        display[3] = 0x02;
-      display[j * DISPLAY_ROW_SIZE + 5] = 0xB0 + j;
+  // After turning on display a 100ms delay is required before writing any
+  // data. The caller renders the first frame in the meantime.
+  ready_time = time_us_32() + 100000;
+
+  for(uint8_t i = 0; i < displays; i++) {
+    states[i].inverse = false;
+    states[i].contrast = 0xFF;
+    states[i].scrolling = false;
+    states[i].inverse_changed = false;
+    states[i].contrast_changed = false;
+    states[i].scroll_changed = false;
+    states[i].redraw = false;
+    for(uint8_t j = 0; j < 2; j++) {
+      current_framebuffer = j;
+      held[j][i] = false;
+      write_row_headers(pio_display_get(i));
+      pio_display_fill(pio_display_get(i), 0x00);
+      write_commands(pio_display_get(i), i, NULL, 0);
     }
-    pio_display_fill(display, 0x00);
   }
   current_framebuffer = 1;
-  for(uint8_t i = 0; i < DISPLAYS; i++) {
-    uint8_t *display = pio_display_get(i);
-    for(uint8_t j = 0; j < DISPLAY_ROWS; j++) {
-      memcpy(display + j * DISPLAY_ROW_SIZE, header, DISPLAY_ROW_HEADER);
-      if(j == 0 && i != 0)
-        display[3] = 0x02;
-      display[j * DISPLAY_ROW_SIZE + 5] = 0xB0 + j;
-    }
-    pio_display_fill(display, 0x00);
-  }
+}
 
-  pio_display_update_and_flip();
-  pio_display_wait_for_finish_blocking();
+static bool ready() {
+  return (int32_t)(time_us_32() - ready_time) >= 0;
 }
 void pio_display_clear_current_framebuffer() {
-  for(uint8_t i = 0; i < DISPLAYS; i++) {
-    pio_display_clear(pio_display_get(i));
+  mutex_enter_blocking(&engine_mutex);
+  engine_wait();
+  dma_channel_set_config(engine_channel, &engine_clear_config, false);
+  dma_channel_set_read_addr(engine_channel, &engine_zero, false);
+  dma_channel_set_trans_count(engine_channel, DISPLAY_ROW / 4, false);
+  engine_start(engine_clear_lists[current_framebuffer], DISPLAY_ROWS, 0, displays);
+  mutex_exit(&engine_mutex);
+}
+
+void pio_display_tile_init(uint8_t * const tile) {
+  write_row_headers(tile);
+  pio_display_clear(tile);
+}
+
+void pio_display_copy(const uint8_t display, const uint8_t * const tile) {
+  if((uintptr_t)tile % 4 != 0) {
+    panic("Display tile not word aligned!");
   }
+  mutex_enter_blocking(&engine_mutex);
+  engine_wait();
+  engine_copy_list[0] = display_address(current_framebuffer, display);
+  engine_copy_list[1] = NULL;
+  dma_channel_set_config(engine_channel, &engine_copy_config, false);
+  dma_channel_set_read_addr(engine_channel, tile, false);
+  dma_channel_set_trans_count(engine_channel, PIO_DISPLAY_TILE_SIZE / 4, false);
+  engine_start(engine_copy_list, 1, display, 1);
+  mutex_exit(&engine_mutex);
 }
 
 void pio_display_update_and_flip() {
-  // Activate first display
+  if(!ready()) {
+    busy_wait_us_32(ready_time - time_us_32());
+  }
+
+  // Activate first display of every chain
   gpio_put(CS, 0);
-  dma_channel_transfer_from_buffer_now(channel, shift1, sizeof(shift1) / sizeof(*shift1));
-  dma_channel_wait_for_finish_blocking(channel);
+  transfer_all(shift1, sizeof(shift1) / 4);
+  pio_display_wait_for_finish_blocking();
 
   // We need to wait for PIO to send the clock pulse to shift in the first bit
   busy_wait_us_32(50);
   gpio_put(CS, 1);
 
+  // A copy started last may still be running
+  mutex_enter_blocking(&engine_mutex);
+  engine_wait();
+  mutex_exit(&engine_mutex);
+  for(uint8_t i = 0; i < displays; i++) {
+    prepare_display(pio_display_get(i), i);
+  }
+
   // Push data to all displays and flip buffer
   if(current_framebuffer == 0) {
-    dma_channel_transfer_from_buffer_now(channel, framebuffer1, FRAMEBUFFER_SIZE_32);
+    transfer_framebuffer(framebuffer1);
     current_framebuffer = 1;
   } else {
-    dma_channel_transfer_from_buffer_now(channel, framebuffer2, FRAMEBUFFER_SIZE_32);
+    transfer_framebuffer(framebuffer2);
     current_framebuffer = 0;
   }
 }
 
-
-
 void pio_display_wait_for_finish_blocking() {
-  dma_channel_wait_for_finish_blocking(channel);
+  for(uint8_t i = 0; i < chains_size; i++) {
+    dma_channel_wait_for_finish_blocking(chains[i].channel);
+  }
 }
 
 bool pio_display_can_wait_without_blocking() {
-  return !dma_channel_is_busy(channel);
+  if(!ready()) {
+    return false;
+  }
+  for(uint8_t i = 0; i < chains_size; i++) {
+    if(dma_channel_is_busy(chains[i].channel)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+void pio_display_invert(const uint8_t display, const bool inverse) {
+  if(states[display].inverse != inverse) {
+    states[display].inverse = inverse;
+    states[display].inverse_changed = true;
+  }
+}
+
+void pio_display_contrast(const uint8_t display, const uint8_t contrast) {
+  if(states[display].contrast != contrast) {
+    states[display].contrast = contrast;
+    states[display].contrast_changed = true;
+  }
+}
+
+void pio_display_scroll(const uint8_t display, const bool left, const uint8_t start_page, const uint8_t end_page, const uint8_t interval) {
+  if(start_page > end_page || end_page >= DISPLAY_ROWS || interval > 7) {
+    panic("Invalid display scroll!");
+  }
+  display_state_t * const state = &states[display];
+  if(state->scrolling && state->scroll_left == left && state->scroll_start == start_page && state->scroll_end == end_page && state->scroll_interval == interval) {
+    return;
+  }
+  state->scrolling = true;
+  state->scroll_left = left;
+  state->scroll_start = start_page;
+  state->scroll_end = end_page;
+  state->scroll_interval = interval;
+  state->scroll_changed = true;
+}
+
+void pio_display_scroll_stop(const uint8_t display) {
+  if(states[display].scrolling) {
+    states[display].scrolling = false;
+    states[display].scroll_changed = true;
+    states[display].redraw = held[0][display] || held[1][display];
+  }
+}
+
+bool pio_display_redraw(const uint8_t display) {
+  if(states[display].redraw) {
+    states[display].redraw = false;
+    return true;
+  }
+  return false;
 }
@@ -1,84 +1,151 @@
 #include "pio_display.h"
+#include "framebuffer.h"
+#include "hot_path.h"
 
-/* Include all fonts */
+// Glyph bitmaps are columns of page bytes, bit n of page p being n + 8 * p
+// pixels above the bottom of the font cell. Generated from the BDF fonts
+// by tools/font_compiler at build time.
+typedef struct {
+  uint16_t offset;
+  uint8_t columns;
+  uint8_t advance;
+} pio_display_glyph_t;
+
+typedef struct {
+  const pio_display_glyph_t * const glyphs;
+  const uint8_t * const bitmaps;
+  uint8_t height;
+  uint8_t pages;
+  uint8_t first;
+  uint16_t size;
+} pio_display_font_t;
+
+#define FONT_SECTION HOT_DATA("fonts")
 #include <fonts.inc>
 
-static uint8_t font_bytes[] = {1, 1, 2, 2};
-static uint8_t font_width[] = {7, 8, 16, 16};
-static uint8_t font_height[] = {13, 18, 28, 32};
-static uint8_t font_offset[] = {13, 18, 28*2, 32*2};
-static uint8_t *fonts[] = {font_13, font_18, font_28, NULL};
-
-void pio_display_fill_rectangle(uint8_t * const fb,
-                                const uint8_t startx, const uint8_t starty,
-                                const uint8_t endx, const uint8_t endy) {
-  for(uint8_t x = startx; x <= endx; x++) {
-    for(uint8_t y = starty; y <= endy; y++) {
-      pio_display_pixel(fb, x, y, true);
+// Sets whole page bytes, one mask per page instead of a read, modify and
+// write per pixel. Columns and rows beyond the display are clipped.
+void HOT_PATH(pio_display_fill_rectangle)(uint8_t * const fb,
+                                                const uint8_t startx, const uint8_t starty,
+                                                const uint8_t endx, const uint8_t endy) {
+  const uint8_t last_x = MIN(endx, DISPLAY_WIDTH - 1);
+  const uint8_t last_y = MIN(endy, DISPLAY_ROWS * 8 - 1);
+  if(startx > last_x || starty > last_y) {
+    return;
+  }
+  for(uint8_t page = starty / 8; page <= last_y / 8; page++) {
+    const uint8_t low = page == starty / 8 ? starty % 8 : 0;
+    const uint8_t high = page == last_y / 8 ? last_y % 8 : 7;
+    const uint8_t mask = (0xFF << low) & (0xFF >> (7 - high));
+    uint8_t * const row = fb + page * DISPLAY_ROW_SIZE + DISPLAY_ROW_HEADER;
+    for(uint8_t x = startx; x <= last_x; x++) {
+      row[x] |= mask;
     }
   }
 }
 
-void pio_display_printc(uint8_t * const fb, const uint8_t startx, const uint8_t starty, const pio_display_font_size_t font_size, const bool on, const char c) {
-    uint32_t index = (uint32_t)c * font_offset[font_size];
-    for(uint8_t i = 0; i < font_height[font_size]; i++) {
-        uint8_t y = starty + font_height[font_size] - i;
-        for(uint8_t b = 0; b < font_bytes[font_size]; b++) {
-            uint8_t segment = fonts[font_size][index + (i * font_bytes[font_size]) + b];
-            for(uint8_t j = 0; j < 8; j++) {
-                uint8_t p = (segment >> j) & 0x01;
-                if(p) {
-                    uint8_t x = startx + (8 - j) + (8 * b);
-                     pio_display_pixel(fb, x, y, on);
-                }
-            }
-        }
+static const pio_display_glyph_t * glyph(const pio_display_font_t * const font, const uint8_t c) {
+  if(c < font->first || c - font->first >= font->size) {
+    return NULL;
+  }
+  return &font->glyphs[c - font->first];
+}
+
+static void draw_bits(uint8_t * const fb, const uint8_t page, const uint8_t x, const uint8_t bits, const bool on) {
+  if(page >= DISPLAY_ROWS || bits == 0) {
+    return;
+  }
+  uint8_t * const segment = fb + page * DISPLAY_ROW_SIZE + DISPLAY_ROW_HEADER + x;
+  if(on) {
+    *segment |= bits;
+  } else {
+    *segment &= ~bits;
+  }
+}
+
+// The bottom of the glyph is one row above starty. A glyph starting on a
+// page boundary takes one write per byte, otherwise every byte is split
+// across two pages. Columns beyond the display are clipped.
+static uint8_t HOT_PATH(draw_glyph)(uint8_t * const fb, const uint16_t startx, const uint8_t starty, const pio_display_font_t * const font, const bool on, const uint8_t c) {
+  const pio_display_glyph_t * const g = glyph(font, c);
+  if(g == NULL) {
+    return 0;
+  }
+  const uint8_t bottom = starty + 1;
+  const uint8_t page = bottom / 8;
+  const uint8_t shift = bottom % 8;
+  const uint8_t * column = font->bitmaps + g->offset;
+  for(uint8_t i = 0; i < g->columns && startx + i < DISPLAY_WIDTH; i++) {
+    const uint8_t x = startx + i;
+    for(uint8_t p = 0; p < font->pages; p++) {
+      const uint16_t bits = (uint16_t)column[p] << shift;
+      draw_bits(fb, page + p, x, bits & 0xFF, on);
+      if(shift != 0) {
+        draw_bits(fb, page + p + 1, x, bits >> 8, on);
+      }
     }
+    column += font->pages;
+  }
+  return g->advance;
 }
 
-void pio_display_print(uint8_t * const fb, const uint8_t startx, const uint8_t starty, const pio_display_font_size_t font_size, const bool on, const char * const str) {
-    const char * c = str;
-    uint8_t x = startx;
-    while (*c) {
-        const char chr = *c++;
-        if(chr != ' ') {
-            pio_display_printc(fb, x, starty, font_size, on, chr);
-            x += font_bytes[font_size]*8;
-        } else {
-            x += 8;
-        }
+void HOT_PATH(pio_display_printc)(uint8_t * const fb, const uint8_t startx, const uint8_t starty, const pio_display_font_size_t font_size, const bool on, const char c) {
+  draw_glyph(fb, startx, starty, &fonts[font_size], on, c);
+}
+
+void HOT_PATH(pio_display_print)(uint8_t * const fb, const uint8_t startx, const uint8_t starty, const pio_display_font_size_t font_size, const bool on, const char * const str) {
+  uint16_t x = startx;
+  for(const char * c = str; *c && x < DISPLAY_WIDTH; c++) {
+    x += draw_glyph(fb, x, starty, &fonts[font_size], on, *c);
+  }
+}
+
+void HOT_PATH(pio_display_print_glyphs)(uint8_t * const fb, const uint8_t startx, const uint8_t starty, const pio_display_font_size_t font_size, const bool on, const uint8_t * const glyphs, const uint8_t size) {
+  uint16_t x = startx;
+  for(uint8_t i = 0; i < size && x < DISPLAY_WIDTH; i++) {
+    x += draw_glyph(fb, x, starty, &fonts[font_size], on, glyphs[i]);
+  }
+}
+
+// Up to the last inked column, without the spacing after the last glyph
+static pio_display_box_t HOT_PATH(box)(const pio_display_font_size_t font_size, const uint8_t * const glyphs, const uint8_t size) {
+  const pio_display_font_t * const font = &fonts[font_size];
+  uint16_t x = 0;
+  uint16_t width = 0;
+  for(uint8_t i = 0; i < size; i++) {
+    const pio_display_glyph_t * const g = glyph(font, glyphs[i]);
+    if(g != NULL) {
+      width = MAX(width, x + g->columns);
+      x += g->advance;
     }
+  }
+  const pio_display_box_t box = {MIN(width, 255), font->height};
+  return box;
 }
 
 pio_display_box_t pio_display_text_box(const pio_display_font_size_t font_size, const char * const str) {
-    const char * c = str;
-    uint8_t len = 0;
-    while (*c) {
-        const char chr = *c++;
-        if(chr != ' ') {
-            len += font_bytes[font_size];
-        } else {
-            len += 1;
-        }
-    }
-    const uint8_t width = 8 * len;
+  uint8_t size = 0;
+  while(str[size] && size < 255) {
+    size++;
+  }
+  return box(font_size, (const uint8_t *)str, size);
+}
 
-    const pio_display_box_t box = {width, font_height[font_size]};
-    return box;
+pio_display_box_t pio_display_glyphs_box(const pio_display_font_size_t font_size, const uint8_t * const glyphs, const uint8_t size) {
+  return box(font_size, glyphs, size);
 }
 
+// Text wider than the display starts at its left edge and is clipped
 static uint8_t center_box_x(const pio_display_box_t box) {
-    return (128 - box.width) / 2;
+  return box.width < DISPLAY_WIDTH ? (DISPLAY_WIDTH - box.width) / 2 : 0;
 }
 
-static uint8_t center_box_y(const pio_display_box_t box) {
-    return (64 - box.height) / 2;
+void HOT_PATH(pio_display_print_center)(uint8_t * const fb, const uint8_t y, const pio_display_font_size_t font_size, const bool on, const char * const str) {
+  const pio_display_box_t box = pio_display_text_box(font_size, str);
+  pio_display_print(fb, center_box_x(box), y, font_size, on, str);
 }
 
-void pio_display_print_center(uint8_t * const fb, const uint8_t y, const pio_display_font_size_t font_size, const bool on, const char * const str) {
-    const pio_display_box_t box = pio_display_text_box(font_size, str);
-    if(box.width < 128) {
-        uint8_t offset = center_box_x(box);
-        pio_display_print(fb, offset, y, font_size, on, str);
-    }
+void HOT_PATH(pio_display_print_glyphs_center)(uint8_t * const fb, const uint8_t y, const pio_display_font_size_t font_size, const bool on, const uint8_t * const glyphs, const uint8_t size) {
+  const pio_display_box_t box = pio_display_glyphs_box(font_size, glyphs, size);
+  pio_display_print_glyphs(fb, center_box_x(box), y, font_size, on, glyphs, size);
 }
@@ -0,0 +1,18 @@
+#pragma once
+#include "pico/stdlib.h"
+
+// Encoders wired directly to GPIO, decoded by state machines on pio1.
+// Without SDHI_PIO_ENCODERS there are none and nothing ever changes.
+#ifdef PIO_ENCODER_ENABLED
+
+void pio_encoder_init();
+
+// Adds the detents turned since the last update to the controllers
+bool pio_encoder_update(int32_t * const change_update);
+
+#else
+
+static inline void pio_encoder_init() {}
+static inline bool pio_encoder_update(int32_t * const change_update) { return false; }
+
+#endif
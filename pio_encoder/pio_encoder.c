@@ -0,0 +1,78 @@
+#include "pico/stdlib.h"
+#include "hardware/pio.h"
+#include "hardware/dma.h"
+#include "pio_encoder.h"
+#include "quadrature.pio.h"
+#include "hot_path.h"
+
+#ifdef PIO_ENCODER_ENABLED
+
+// Four quadrature steps per detent
+#define STEPS_PER_DETENT_SHIFT 2
+#define TRANSFERS 0xFFFFFFFF
+
+// Controller and pin A of every directly wired encoder, pin B is the
+// next pin. pio1 has state machines for four.
+// C   A
+static const uint8_t encoder_connections[][2] = {
+  {0, 2},  // E1
+  {1, 6},  // E2
+  {2, 10}, // E3
+  {3, 14}  // E4
+};
+#define ENCODERS (sizeof(encoder_connections) / sizeof(encoder_connections[0]))
+
+// Position of every encoder in steps. Every step the state machine
+// pushes the new position and DMA writes it here, the CPU only reads
+// the latest one.
+static volatile int32_t positions[ENCODERS];
+static int32_t detents[ENCODERS];
+static uint channels[ENCODERS];
+
+void pio_encoder_init() {
+  if(!pio_can_add_program(pio1, &quadrature_program)) {
+    panic("No room for the quadrature decoder on pio1!");
+  }
+  const uint offset = pio_add_program(pio1, &quadrature_program);
+  for(uint8_t i = 0; i < ENCODERS; i++) {
+    const uint sm = pio_claim_unused_sm(pio1, true);
+    positions[i] = 0;
+    detents[i] = 0;
+
+    channels[i] = dma_claim_unused_channel(true);
+    dma_channel_config channel_config = dma_channel_get_default_config(channels[i]);
+    channel_config_set_dreq(&channel_config, pio_get_dreq(pio1, sm, false));
+    channel_config_set_transfer_data_size(&channel_config, DMA_SIZE_32);
+    channel_config_set_read_increment(&channel_config, false);
+    channel_config_set_write_increment(&channel_config, false);
+    dma_channel_configure(channels[i],
+                          &channel_config,
+                          &positions[i],
+                          &pio1->rxf[sm],
+                          TRANSFERS,
+                          true);
+
+    quadrature_program_init(pio1, sm, offset, encoder_connections[i][1]);
+  }
+}
+
+bool HOT_PATH(pio_encoder_update)(int32_t * const change_update) {
+  bool changed = false;
+
+  for(uint8_t i = 0; i < ENCODERS; i++) {
+    // A channel only runs out after four billion steps
+    if(!dma_channel_is_busy(channels[i])) {
+      dma_channel_set_trans_count(channels[i], TRANSFERS, true);
+    }
+    const int32_t detent = positions[i] >> STEPS_PER_DETENT_SHIFT;
+    if(detent != detents[i]) {
+      change_update[encoder_connections[i][0]] += detent - detents[i];
+      detents[i] = detent;
+      changed = true;
+    }
+  }
+
+  return changed;
+}
+
+#endif
@@ -0,0 +1,42 @@
+#pragma once
+#include "pico/stdlib.h"
+#include "sdhi.h"
+
+#ifndef PRESET_SLOTS
+#define PRESET_SLOTS 16
+#endif
+
+// Flash sectors at the end of flash holding the preset log
+#ifndef PRESET_SECTORS
+#define PRESET_SECTORS 16
+#endif
+
+#define PRESET_NONE -1
+
+// Scans the preset log. Must be called after sdhi_init and before core 1
+// is launched, it may repair the log after a power loss during a flash
+// write. Presets stored under a different setup are not recalled.
+void preset_init(const sdhi_t sdhi);
+
+// Preset of the newest record in the log, PRESET_NONE if the log is empty.
+int16_t preset_last();
+
+bool preset_exists(const uint8_t preset);
+
+// Writes the values of a stored preset through the value store, clamped
+// to the range of their controls. Every value is compared, only values
+// that differ are written. Returns the number of changed values.
+uint32_t preset_recall(const uint8_t preset, const int32_t * const values, const sdhi_t sdhi);
+
+// Snapshots values for the preset. The flash write is deferred to
+// preset_run. A later store of the same preset replaces a pending one,
+// a store of another preset fails until the pending one is written.
+bool preset_store(const uint8_t preset, const int32_t * const values);
+
+bool preset_pending();
+
+// Performs at most one flash operation, i.e. programs one record or
+// erases one sector. Flash writes stall XIP on both cores, so call it
+// when core 1 can afford to be paused. Core 1 must have called
+// multicore_lockout_victim_init.
+void preset_run();
@@ -0,0 +1,334 @@
+#include <string.h>
+#include "pico/stdlib.h"
+#include "pico/multicore.h"
+#include "hardware/flash.h"
+#include "hardware/regs/addressmap.h"
+#include "hardware/sync.h"
+#include "preset.h"
+#include "value.h"
+#include "sdhi.h"
+#include "setup_limits.h"
+
+// The preset log is a ring of flash sectors holding fixed size records,
+// each a full snapshot of the values of one preset. Records are only
+// appended. The sector after the one being written is always kept
+// erased, so the ring never fills up. Entering a sector starts garbage
+// collection of the sector two ahead: records that are still the newest
+// of their preset are appended again and then the sector is erased. At
+// most a sector of records is appended, which fits in the sector being
+// written and the erased one after it. Every sector is erased once per
+// lap of the ring, which spreads wear over the whole region.
+//
+// Records carry a hash of the setup they were stored under. Records of
+// another setup keep their place in the log but are never recalled and
+// are dropped by garbage collection.
+
+#if PRESET_SECTORS < 4
+#error "The preset log needs at least 4 sectors"
+#endif
+
+#define MAGIC 0x50535432
+#define BLANK 0xFFFFFFFF
+#define NO_RECORD 0xFFFF
+#define NO_SECTOR 0xFF
+#define REGION_OFFSET (PICO_FLASH_SIZE_BYTES - PRESET_SECTORS * FLASH_SECTOR_SIZE)
+
+typedef struct {
+  uint32_t magic;
+  uint32_t sequence;
+  uint16_t preset;
+  uint16_t values_size;
+  uint32_t setup;
+  uint32_t checksum;
+} record_header_t;
+
+#define RECORD_MAX_SIZE (((sizeof(record_header_t) + SETUP_MAX_VALUES * sizeof(int32_t)) + FLASH_PAGE_SIZE - 1) / FLASH_PAGE_SIZE * FLASH_PAGE_SIZE)
+
+static uint32_t values_size;
+static uint32_t setup;
+static uint32_t record_size;
+static uint16_t records_per_sector;
+static uint16_t records;
+
+// Newest record of every preset
+static uint16_t newest_records[PRESET_SLOTS];
+static uint16_t head;
+static uint32_t sequence;
+static uint8_t collect_sector;
+
+static int32_t pending_values[SETUP_MAX_VALUES];
+static int16_t pending_preset;
+
+static uint8_t record_buffer[RECORD_MAX_SIZE] __attribute__((aligned(4)));
+
+static uint32_t record_offset(const uint16_t record) {
+  return REGION_OFFSET + (record / records_per_sector) * FLASH_SECTOR_SIZE + (record % records_per_sector) * record_size;
+}
+
+static const record_header_t * record_header(const uint16_t record) {
+  return (const record_header_t *)(XIP_BASE + record_offset(record));
+}
+
+static const int32_t * record_values(const uint16_t record) {
+  return (const int32_t *)(XIP_BASE + record_offset(record) + sizeof(record_header_t));
+}
+
+static uint8_t sector(const uint16_t record) {
+  return record / records_per_sector;
+}
+
+static uint8_t next_sector(const uint8_t sector) {
+  return (sector + 1) % PRESET_SECTORS;
+}
+
+static uint32_t checksum(const record_header_t * const header, const int32_t * const values) {
+  uint32_t sum = (2166136261u ^ header->sequence ^ ((uint32_t)header->preset << 16) ^ header->values_size) * 16777619u;
+  sum = (sum ^ header->setup) * 16777619u;
+  for(uint32_t i = 0; i < header->values_size; i++) {
+    sum = (sum ^ (uint32_t)values[i]) * 16777619u;
+  }
+  return sum;
+}
+
+// Intact records take part in the order of the log, valid ones also
+// belong to the current setup
+static bool intact(const uint16_t record) {
+  const record_header_t * const header = record_header(record);
+  return header->magic == MAGIC
+    && header->preset < PRESET_SLOTS
+    && header->values_size == values_size
+    && header->checksum == checksum(header, record_values(record));
+}
+
+static bool valid(const uint16_t record) {
+  return intact(record) && record_header(record)->setup == setup;
+}
+
+static bool blank(const uint32_t offset, const uint32_t size) {
+  const uint32_t * const words = (const uint32_t *)(XIP_BASE + offset);
+  for(uint32_t i = 0; i < size / 4; i++) {
+    if(words[i] != BLANK) {
+      return false;
+    }
+  }
+  return true;
+}
+
+// Before core 1 is launched there is nobody to lock out
+static void flash_begin(bool * const lockout, uint32_t * const interrupts) {
+  *lockout = multicore_lockout_victim_is_initialized(1);
+  if(*lockout) {
+    multicore_lockout_start_blocking();
+  }
+  *interrupts = save_and_disable_interrupts();
+}
+
+static void flash_end(const bool lockout, const uint32_t interrupts) {
+  restore_interrupts(interrupts);
+  if(lockout) {
+    multicore_lockout_end_blocking();
+  }
+}
+
+static void erase(const uint8_t sector) {
+  bool lockout;
+  uint32_t interrupts;
+  flash_begin(&lockout, &interrupts);
+  flash_range_erase(REGION_OFFSET + sector * FLASH_SECTOR_SIZE, FLASH_SECTOR_SIZE);
+  flash_end(lockout, interrupts);
+}
+
+static void append(const uint16_t preset, const int32_t * const values) {
+  record_header_t header = {
+    .magic = MAGIC,
+    .sequence = ++sequence,
+    .preset = preset,
+    .values_size = values_size,
+    .setup = setup
+  };
+  header.checksum = checksum(&header, values);
+  memset(record_buffer, 0xFF, record_size);
+  memcpy(record_buffer, &header, sizeof(header));
+  memcpy(record_buffer + sizeof(header), values, values_size * sizeof(int32_t));
+
+  bool lockout;
+  uint32_t interrupts;
+  flash_begin(&lockout, &interrupts);
+  flash_range_program(record_offset(head), record_buffer, record_size);
+  flash_end(lockout, interrupts);
+
+  newest_records[preset] = head;
+  head = (head + 1) % records;
+  if(head % records_per_sector == 0 && collect_sector == NO_SECTOR) {
+    collect_sector = next_sector(next_sector(sector(head)));
+  }
+}
+
+static uint16_t live_record(const uint8_t sector) {
+  for(uint8_t i = 0; i < PRESET_SLOTS; i++) {
+    if(newest_records[i] != NO_RECORD && newest_records[i] / records_per_sector == sector) {
+      return newest_records[i];
+    }
+  }
+  return NO_RECORD;
+}
+
+static bool blank_sector(const uint8_t sector) {
+  return blank(REGION_OFFSET + sector * FLASH_SECTOR_SIZE, FLASH_SECTOR_SIZE);
+}
+
+// One step of garbage collection. If the live records did not fit in
+// the current sector, head has moved into the erased sector after it,
+// right before the collected one, and the sector after the collected one
+// is collected next.
+static void collect() {
+  const uint16_t record = live_record(collect_sector);
+  if(record != NO_RECORD) {
+    append(record_header(record)->preset, record_values(record));
+    return;
+  }
+  erase(collect_sector);
+  const uint8_t erased = collect_sector;
+  collect_sector = NO_SECTOR;
+  if(next_sector(sector(head)) == erased) {
+    collect_sector = next_sector(erased);
+  }
+}
+
+static void erase_all() {
+  for(uint8_t i = 0; i < PRESET_SECTORS; i++) {
+    erase(i);
+  }
+  head = 0;
+  sequence = 0;
+  for(uint8_t i = 0; i < PRESET_SLOTS; i++) {
+    newest_records[i] = NO_RECORD;
+  }
+}
+
+void preset_init(const sdhi_t sdhi) {
+  if(sdhi.controls_size > SETUP_MAX_VALUES) {
+    panic("Too many values for presets!");
+  }
+  values_size = sdhi.controls_size;
+  setup = sdhi_hash(sdhi);
+  record_size = (sizeof(record_header_t) + values_size * sizeof(int32_t) + FLASH_PAGE_SIZE - 1) / FLASH_PAGE_SIZE * FLASH_PAGE_SIZE;
+  records_per_sector = FLASH_SECTOR_SIZE / record_size;
+  records = records_per_sector * PRESET_SECTORS;
+  // Two sectors are erased or being collected and every preset needs a
+  // record, leave a sector of stale records so collection frees space
+  if(PRESET_SLOTS > records_per_sector * (PRESET_SECTORS - 3)) {
+    panic("Preset log too small!");
+  }
+  pending_preset = PRESET_NONE;
+  collect_sector = NO_SECTOR;
+
+  for(uint8_t i = 0; i < PRESET_SLOTS; i++) {
+    newest_records[i] = NO_RECORD;
+  }
+  uint16_t newest = NO_RECORD;
+  sequence = 0;
+  for(uint16_t i = 0; i < records; i++) {
+    if(intact(i)) {
+      const record_header_t * const header = record_header(i);
+      if(valid(i) && (newest_records[header->preset] == NO_RECORD || header->sequence > record_header(newest_records[header->preset])->sequence)) {
+        newest_records[header->preset] = i;
+      }
+      if(newest == NO_RECORD || header->sequence > sequence) {
+        newest = i;
+        sequence = header->sequence;
+      }
+    }
+  }
+  if(newest == NO_RECORD) {
+    erase_all();
+    return;
+  }
+
+  // Skip a record left half written by a power loss
+  head = (newest + 1) % records;
+  if(head % records_per_sector != 0 && !blank(record_offset(head), record_size)) {
+    head = (head + 1) % records;
+  }
+  // A sector is only entered erased, but a record half written by a
+  // power loss can start it. Anything live there means a corrupt log.
+  if(head % records_per_sector == 0 && !blank_sector(sector(head))) {
+    if(live_record(sector(head)) != NO_RECORD) {
+      erase_all();
+      return;
+    }
+    erase(sector(head));
+  }
+  // Finish a garbage collection interrupted by a power loss. The sector
+  // after head holds records only if appending spilled into head's
+  // sector, the one after that if it wasn't erased yet.
+  const uint8_t gap = next_sector(sector(head));
+  if(!blank_sector(gap)) {
+    collect_sector = gap;
+  } else if(!blank_sector(next_sector(gap))) {
+    collect_sector = next_sector(gap);
+  }
+  while(collect_sector != NO_SECTOR) {
+    collect();
+  }
+}
+
+int16_t preset_last() {
+  int16_t last = PRESET_NONE;
+  for(uint8_t i = 0; i < PRESET_SLOTS; i++) {
+    if(newest_records[i] != NO_RECORD && (last == PRESET_NONE || record_header(newest_records[i])->sequence > record_header(newest_records[last])->sequence)) {
+      last = i;
+    }
+  }
+  return last;
+}
+
+bool preset_exists(const uint8_t preset) {
+  return preset < PRESET_SLOTS && (newest_records[preset] != NO_RECORD || preset == pending_preset);
+}
+
+uint32_t preset_recall(const uint8_t preset, const int32_t * const values, const sdhi_t sdhi) {
+  const int32_t * stored;
+  if(preset == pending_preset) {
+    stored = pending_values;
+  } else if(preset_exists(preset)) {
+    stored = record_values(newest_records[preset]);
+  } else {
+    return 0;
+  }
+  uint32_t changed = 0;
+  for(uint32_t i = 0; i < values_size; i++) {
+    const int32_t value = sdhi_clamp_value(i, stored[i], sdhi);
+    if(values[i] != value) {
+      value_set(i, value);
+      changed++;
+    }
+  }
+  return changed;
+}
+
+bool preset_store(const uint8_t preset, const int32_t * const values) {
+  if(preset >= PRESET_SLOTS) {
+    panic("No such preset!");
+  }
+  if(pending_preset != PRESET_NONE && pending_preset != preset) {
+    return false;
+  }
+  memcpy(pending_values, values, values_size * sizeof(int32_t));
+  pending_preset = preset;
+  return true;
+}
+
+bool preset_pending() {
+  return pending_preset != PRESET_NONE || collect_sector != NO_SECTOR;
+}
+
+void preset_run() {
+  if(collect_sector != NO_SECTOR) {
+    collect();
+  } else if(pending_preset != PRESET_NONE) {
+    const uint8_t preset = pending_preset;
+    pending_preset = PRESET_NONE;
+    append(preset, pending_values);
+  }
+}
@@ -0,0 +1,30 @@
+#pragma once
+#include "pico/stdlib.h"
+
+#ifndef SCHEDULER_MAX_TASKS
+#define SCHEDULER_MAX_TASKS 8
+#endif
+
+// A periodic task (period_us non-zero) is released every period_us. An
+// event task is released whenever ready returns true, or all the time
+// when ready is NULL. A released task must finish within deadline_us of
+// its release, otherwise it overran. Released tasks run earliest
+// deadline first. Tasks without a deadline (deadline_us 0) only run when
+// no task with a deadline is released, in turn.
+typedef struct {
+  const char * name;
+  void (*run)();
+  bool (*ready)();
+  uint32_t period_us;
+  uint32_t deadline_us;
+} scheduler_task_t;
+
+// Cooperative, tasks run to completion on the calling core. Only one core
+// may run the scheduler. Runs, overruns, the longest run and the longest
+// time from release to finish of every task are part of the trace dump.
+// Releases of a periodic task that pass while it is still late count as
+// overruns too.
+void scheduler_init(const scheduler_task_t * const tasks, const uint8_t tasks_size);
+
+// Runs the most urgent released task, if any
+void scheduler_run();
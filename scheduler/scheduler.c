@@ -0,0 +1,140 @@
+#include <stdio.h>
+#include "scheduler.h"
+#include "trace.h"
+#include "hot_path.h"
+
+#define NO_TASK -1
+
+typedef struct {
+  bool released;
+  uint32_t release;
+  uint32_t deadline;
+  uint32_t runs;
+  uint32_t overruns;
+  uint32_t max_run;
+  uint32_t max_response;
+} task_state_t;
+
+static const scheduler_task_t * scheduler_tasks;
+static uint8_t scheduler_tasks_size;
+static task_state_t states[SCHEDULER_MAX_TASKS];
+// Task without deadline that runs next when nothing else is released
+static uint8_t next_background;
+
+static bool before(const uint32_t a, const uint32_t b) {
+  return (int32_t)(a - b) < 0;
+}
+
+static void release(const uint8_t i, const uint32_t now) {
+  const scheduler_task_t * const task = &scheduler_tasks[i];
+  task_state_t * const state = &states[i];
+  if(state->released) {
+    return;
+  }
+  if(task->period_us != 0) {
+    if(before(now, state->release)) {
+      return;
+    }
+  } else if(task->ready != NULL && !task->ready()) {
+    return;
+  } else {
+    state->release = now;
+  }
+  state->released = true;
+  state->deadline = state->release + task->deadline_us;
+}
+
+static int16_t most_urgent() {
+  int16_t urgent = NO_TASK;
+  for(uint8_t i = 0; i < scheduler_tasks_size; i++) {
+    if(states[i].released && scheduler_tasks[i].deadline_us != 0 && (urgent == NO_TASK || before(states[i].deadline, states[urgent].deadline))) {
+      urgent = i;
+    }
+  }
+  if(urgent != NO_TASK) {
+    return urgent;
+  }
+  for(uint8_t j = 0; j < scheduler_tasks_size; j++) {
+    const uint8_t i = (next_background + j) % scheduler_tasks_size;
+    if(states[i].released) {
+      next_background = (i + 1) % scheduler_tasks_size;
+      return i;
+    }
+  }
+  return NO_TASK;
+}
+
+static void finish(const uint8_t i, const uint32_t begin, const uint32_t end) {
+  const scheduler_task_t * const task = &scheduler_tasks[i];
+  task_state_t * const state = &states[i];
+  state->released = false;
+  state->runs++;
+  state->max_run = MAX(state->max_run, end - begin);
+  state->max_response = MAX(state->max_response, end - state->release);
+  if(task->deadline_us != 0 && before(state->deadline, end)) {
+    state->overruns++;
+  }
+  if(task->period_us != 0) {
+    state->release += task->period_us;
+    // Releases that passed while the task ran are merged into one
+    if(!before(end, state->release + task->period_us)) {
+      const uint32_t skipped = (end - state->release) / task->period_us;
+      state->release += skipped * task->period_us;
+      state->overruns += skipped;
+    }
+  }
+}
+
+static void dump() {
+  for(uint8_t i = 0; i < scheduler_tasks_size; i++) {
+    const task_state_t state = states[i];
+    printf("task %-11s n=%lu overruns=%lu max run=%luus max response=%luus\n",
+           scheduler_tasks[i].name,
+           (unsigned long)state.runs,
+           (unsigned long)state.overruns,
+           (unsigned long)state.max_run,
+           (unsigned long)state.max_response);
+  }
+}
+
+static void reset() {
+  for(uint8_t i = 0; i < scheduler_tasks_size; i++) {
+    states[i].runs = 0;
+    states[i].overruns = 0;
+    states[i].max_run = 0;
+    states[i].max_response = 0;
+  }
+}
+
+void scheduler_init(const scheduler_task_t * const tasks, const uint8_t tasks_size) {
+  if(tasks_size == 0 || tasks_size > SCHEDULER_MAX_TASKS) {
+    panic("Unsupported number of scheduler tasks!");
+  }
+  scheduler_tasks = tasks;
+  scheduler_tasks_size = tasks_size;
+  next_background = 0;
+  const uint32_t now = time_us_32();
+  for(uint8_t i = 0; i < tasks_size; i++) {
+    states[i].released = false;
+    states[i].release = now;
+    states[i].runs = 0;
+    states[i].overruns = 0;
+    states[i].max_run = 0;
+    states[i].max_response = 0;
+  }
+  trace_add_counters(dump, reset);
+}
+
+void HOT_PATH(scheduler_run)() {
+  const uint32_t now = time_us_32();
+  for(uint8_t i = 0; i < scheduler_tasks_size; i++) {
+    release(i, now);
+  }
+  const int16_t task = most_urgent();
+  if(task == NO_TASK) {
+    return;
+  }
+  const uint32_t begin = time_us_32();
+  scheduler_tasks[task].run();
+  finish(task, begin, time_us_32());
+}
@@ -50,10 +50,20 @@ typedef struct {
   const char * const title;
 } sdhi_group_t;
 
+// Controls per panel. The panel selector encoder follows the control
+// encoders, so this must match the encoders on the I2C bus.
+#ifndef SDHI_PANEL_CONTROLS
+#define SDHI_PANEL_CONTROLS 8
+#endif
+
+#ifndef SDHI_MAX_SLOTS
+#define SDHI_MAX_SLOTS 32
+#endif
+
 typedef struct {
   const char * title;
   const char * subtitle;
-  int32_t controls[8];
+  int32_t controls[SDHI_PANEL_CONTROLS];
 } sdhi_panel_t;
 
 typedef struct {
@@ -66,11 +76,38 @@ typedef struct {
   const uint32_t panels_size;
 } sdhi_t;
 
-void sdhi_init(const sdhi_t sdhi);
+// Layout of the display matrix. Slots are laid out row by row, each
+// slot_width + 1 displays wide with neighbouring slots sharing their
+// edge display. With separators, a row of columns + 1 displays sits
+// between every two display rows. Panel controls are assigned to the
+// slots in order, skipping the panel selector slot.
+typedef struct {
+  uint8_t columns;
+  uint8_t rows;
+  uint8_t slot_width;
+  bool separators;
+  uint8_t selector_x;
+  uint8_t selector_y;
+} sdhi_geometry_t;
+
+uint8_t sdhi_displays(const sdhi_geometry_t geometry);
+void sdhi_init(const sdhi_t sdhi, const sdhi_geometry_t geometry);
 void sdhi_init_values(int32_t * const values, const sdhi_t sdhi);
-bool sdhi_update_values(int32_t * const values, const sdhi_t sdhi);
+// Applies encoder changes to the values through the value store
+bool sdhi_update_values(const int32_t * const values, const sdhi_t sdhi);
+// Renders a frame if values or the panel changed since the last two
 void sdhi_update_displays(const int32_t * const values, const sdhi_t sdhi);
+void sdhi_render_run();
 sdhi_control_type_t sdhi_type(const uint16_t id, const sdhi_t sdhi);
 int32_t sdhi_integer(const uint16_t id, const int32_t * const values, const sdhi_t sdhi);
 float sdhi_real(const uint16_t id, const int32_t * const values, const sdhi_t sdhi);
 int32_t sdhi_enumeration(const uint16_t id, const int32_t * const values, const sdhi_t sdhi);
+// Inverse of sdhi_integer and sdhi_enumeration. Integers are clamped to
+// their range, false if no enumeration entry has the value.
+bool sdhi_stored_value(const uint16_t id, const int32_t value, int32_t * const stored, const sdhi_t sdhi);
+// Clamps a stored value, e.g. one read back from flash, to the range of
+// its control
+int32_t sdhi_clamp_value(const uint16_t id, const int32_t value, const sdhi_t sdhi);
+// Hash of the controls and their ranges and enumeration values. Stored
+// values only mean the same under the same hash. Call after sdhi_init.
+uint32_t sdhi_hash(const sdhi_t sdhi);
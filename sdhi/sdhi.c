@@ -1,7 +1,12 @@
-#include <stdio.h>
 #include <i2c_controller.h>
+#include <pio_encoder.h>
 #include <pio_display.h>
 #include <sdhi.h>
+#include <format.h>
+#include <value.h>
+#include "setup_limits.h"
+#include "hot_path.h"
+#include "pico/mutex.h"
 
 #define WIDTH 4
 #define HALF_WIDTH (WIDTH / 2)
@@ -10,38 +15,145 @@
 #define COLUMN_LEFT (64 - HALF_WIDTH)
 #define COLUMN_RIGHT (64 + HALF_WIDTH)
 
-static void draw_lower_column(uint8_t * const fd) {
+#define BAR_WIDTH 96
+#define SCALE_SHIFT 16
+#define REAL_DECIMALS 2
+#define REAL_DECIMALS_SCALE 100
+
+// Per control constants for drawing, precomputed so the draw path is integer only
+typedef struct {
+  int32_t min;
+  int32_t max;
+  uint32_t scale;
+  uint32_t middle;
+  int32_t step;
+} sdhi_scale_t;
+
+static sdhi_scale_t scales[SETUP_MAX_CONTROLS];
+
+static void HOT_PATH(draw_lower_column)(uint8_t * const fd) {
     pio_display_fill_rectangle(fd, COLUMN_LEFT, 0, COLUMN_RIGHT, ROW_TOP);
 }
 
-static void draw_upper_column(uint8_t *const fd) {
+static void HOT_PATH(draw_upper_column)(uint8_t *const fd) {
     pio_display_fill_rectangle(fd, COLUMN_LEFT, ROW_TOP, COLUMN_RIGHT, 63);
 }
 
-static void draw_right_row(uint8_t * const fd) {
+static void HOT_PATH(draw_right_row)(uint8_t * const fd) {
     pio_display_fill_rectangle(fd, COLUMN_LEFT, ROW_TOP, 127, ROW_BOTTOM);
 }
 
-static void draw_left_row(uint8_t * const fd) {
+static void HOT_PATH(draw_left_row)(uint8_t * const fd) {
     pio_display_fill_rectangle(fd, 0, ROW_TOP, COLUMN_RIGHT, ROW_BOTTOM);
 }
 
-static void draw_row(uint8_t * const fd) {
+static void HOT_PATH(draw_row)(uint8_t * const fd) {
     pio_display_fill_rectangle(fd, 0, ROW_TOP, 127, ROW_BOTTOM);
 }
 
-static void draw_column(uint8_t * const fd) {
+static void HOT_PATH(draw_column)(uint8_t * const fd) {
     pio_display_fill_rectangle(fd, COLUMN_LEFT, 0, COLUMN_RIGHT, 63);
 }
 
 static uint32_t current_panel;
 
-void sdhi_init(const sdhi_t sdhi) {
+// Encoder detents towards the next enumeration value, per control
+static int8_t accumulators[SETUP_MAX_CONTROLS];
+
+// Frames still to render. Both framebuffers have to be redrawn after a
+// change, after that they hold the same frame and rendering is skipped.
+// stale_frames redraws everything, a value change only redraws the slots
+// drawing on the display showing the value.
+#define FRAMEBUFFERS 2
+static uint8_t stale_frames;
+static uint8_t stale_slots[SDHI_MAX_SLOTS];
+static uint8_t stale_displays[PIO_DISPLAY_MAX_DISPLAYS];
+static sdhi_geometry_t geometry;
+
+static uint32_t bar_scale(const int32_t min, const int32_t max) {
+  if(max <= min) {
+    return 0;
+  }
+  // Round up so that the maximum value always spans the whole bar
+  return ((BAR_WIDTH << SCALE_SHIFT) + (max - min) - 1) / (max - min);
+}
+
+static uint32_t HOT_PATH(bar_position)(const sdhi_scale_t * const scale, const int32_t value) {
+  if(value <= scale->min) {
+    return 0;
+  }
+  return MIN(((uint32_t)(value - scale->min) * scale->scale) >> SCALE_SHIFT, BAR_WIDTH);
+}
+
+static void init_scale(const sdhi_control_t * const control, sdhi_scale_t * const scale) {
+  switch(control->type) {
+  case SDHI_CONTROL_TYPE_INTEGER:
+    scale->min = control->configuration.integer.min;
+    scale->max = control->configuration.integer.max;
+    scale->scale = bar_scale(scale->min, scale->max);
+    scale->middle = bar_position(scale, control->configuration.integer.middle);
+    scale->step = 0;
+    break;
+  case SDHI_CONTROL_TYPE_REAL:
+    scale->min = (int32_t)(control->configuration.real.min / control->configuration.real.step);
+    scale->max = (int32_t)(control->configuration.real.max / control->configuration.real.step);
+    scale->scale = bar_scale(scale->min, scale->max);
+    scale->middle = 0;
+    scale->step = (int32_t)(control->configuration.real.step * REAL_DECIMALS_SCALE * (1 << SCALE_SHIFT) + 0.5f);
+    break;
+  case SDHI_CONTROL_TYPE_ENUMERATION:
+    scale->min = 0;
+    scale->max = (int32_t)control->configuration.enumeration.size - 1;
+    scale->scale = 0;
+    scale->middle = 0;
+    scale->step = 0;
+    break;
+  }
+}
+
+static uint32_t displays(const sdhi_geometry_t geometry);
+static void init_slots(const sdhi_geometry_t geometry);
+static void init_render_items(const sdhi_geometry_t geometry);
+
+void sdhi_init(const sdhi_t sdhi, const sdhi_geometry_t faceplate) {
   current_panel = 0;
+  stale_frames = FRAMEBUFFERS;
+  if(sdhi.controls_size > SETUP_MAX_CONTROLS) {
+    panic("Too many SDHI controls!");
+  }
+  if(faceplate.columns * faceplate.rows > SDHI_MAX_SLOTS || faceplate.slot_width < 2
+     || faceplate.selector_x >= faceplate.columns || faceplate.selector_y >= faceplate.rows
+     || displays(faceplate) > PIO_DISPLAY_MAX_DISPLAYS) {
+    panic("Unsupported SDHI geometry!");
+  }
+  geometry = faceplate;
+  init_slots(geometry);
+  init_render_items(geometry);
+  for(uint32_t i = 0; i < sdhi.controls_size; i++) {
+    init_scale(&sdhi.controls[i], &scales[i]);
+  }
 }
 
-static const sdhi_control_t * const find_control(const int16_t id, const sdhi_t sdhi) {
-  for(uint8_t i = 0; i < sdhi.controls_size; i++) {
+static const sdhi_scale_t * const control_scale(const sdhi_control_t * const control, const sdhi_t sdhi) {
+  return &scales[control - sdhi.controls];
+}
+
+// Value in hundredths, rounded to nearest as "%.2f" would
+static int32_t HOT_PATH(real_hundredths)(const sdhi_scale_t * const scale, const int32_t value) {
+  const int64_t fixed = (int64_t)value * scale->step;
+  const int64_t half = 1 << (SCALE_SHIFT - 1);
+  if(fixed < 0) {
+    return -(int32_t)((-fixed + half) >> SCALE_SHIFT);
+  }
+  return (int32_t)((fixed + half) >> SCALE_SHIFT);
+}
+
+// Controls are usually laid out by id, which avoids the search
+static const sdhi_control_t * const HOT_PATH(find_control)(const int16_t id, const sdhi_t sdhi) {
+  if(id >= 0 && id < sdhi.controls_size && sdhi.controls[id].id == id) {
+    return &(sdhi.controls[id]);
+  }
+  for(uint32_t i = 0; i < sdhi.controls_size; i++) {
     if(sdhi.controls[i].id == id) {
       return &(sdhi.controls[i]);
     }
@@ -64,15 +176,14 @@ static int32_t update_integer(const sdhi_control_type_integer_t integer, const i
   return update(value, change, integer.min, integer.max);
 }
 
-static int32_t update_real(const sdhi_control_type_real_t real, const int32_t value, const int32_t change) {
-  return update(value, change, (int32_t)(real.min / real.step), (int32_t)(real.max / real.step));
+static int32_t update_real(const sdhi_scale_t * const scale, const int32_t value, const int32_t change) {
+  return update(value, change, scale->min, scale->max);
 }
 
-static int32_t update_enumeration(const sdhi_control_type_enumeration_t enumeration, const int32_t value, const int32_t change) {
+static int32_t update_enumeration(const sdhi_control_type_enumeration_t enumeration, int8_t * const accumulator, const int32_t value, const int32_t change) {
   const int32_t max = (int32_t)enumeration.size - 1;
-  int8_t acc = (value >> 24) & 0xFF;
-  acc += change;
-  int32_t i = value & 0xFFFFFF;
+  int8_t acc = *accumulator + change;
+  int32_t i = value;
   if(i == 0 && acc < 0) {
     acc = 0;
   } else if(i == max && acc > 0) {
@@ -86,38 +197,42 @@ static int32_t update_enumeration(const sdhi_control_type_enumeration_t enumerat
     i = update(i, -1, 0, max);
     acc = 0;
   }
-  return (acc << 24) + i;
+  *accumulator = acc;
+  return i;
 }
 
-static void update_values(int32_t * const values, const int32_t * const change, const sdhi_t sdhi) {
-  for(uint8_t i = 0; i < 8; i++) {
+static void update_values(const int32_t * const values, const int32_t * const change, const sdhi_t sdhi) {
+  for(uint8_t i = 0; i < SDHI_PANEL_CONTROLS; i++) {
     const sdhi_control_t * const control = find_control(sdhi.panels[current_panel].controls[i], sdhi);
     if(control != NULL) {
       if(change[i] != 0) {
         switch(control->type) {
         case SDHI_CONTROL_TYPE_INTEGER:
-          values[control->id] = update_integer(control->configuration.integer, values[control->id], change[i]);
+          value_set(control->id, update_integer(control->configuration.integer, values[control->id], change[i]));
           break;
         case SDHI_CONTROL_TYPE_REAL:
-          values[control->id] = update_real(control->configuration.real, values[control->id], change[i]);
+          value_set(control->id, update_real(control_scale(control, sdhi), values[control->id], change[i]));
         break;
         case SDHI_CONTROL_TYPE_ENUMERATION:
-          values[control->id] = update_enumeration(control->configuration.enumeration, values[control->id], change[i]);
+          value_set(control->id, update_enumeration(control->configuration.enumeration, &accumulators[control - sdhi.controls], values[control->id], change[i]));
           break;
         }
       }
     }
   }
-  if(change[8] != 0) {
-    current_panel = update(current_panel, change[8], 0, sdhi.panels_size - 1);
+  if(change[SDHI_PANEL_CONTROLS] != 0) {
+    const uint32_t panel = update(current_panel, change[SDHI_PANEL_CONTROLS], 0, sdhi.panels_size - 1);
+    if(panel != current_panel) {
+      current_panel = panel;
+      stale_frames = FRAMEBUFFERS;
+    }
   }
 }
 
-bool sdhi_update_values(int32_t * const values, const sdhi_t sdhi) {
-  int32_t change[] = {
-    0, 0, 0, 0, 0, 0, 0, 0, 0
-  };
+bool sdhi_update_values(const int32_t * const values, const sdhi_t sdhi) {
+  int32_t change[SDHI_PANEL_CONTROLS + 1] = {0};
   bool updated = i2c_controller_update(change);
+  updated |= pio_encoder_update(change);
   update_values(values, change, sdhi);
   return updated;
 }
@@ -125,6 +240,7 @@ bool sdhi_update_values(int32_t * const values, const sdhi_t sdhi) {
 void sdhi_init_values(int32_t * const values, const sdhi_t sdhi) {
   for(uint16_t i = 0; i < sdhi.controls_size; i++) {
     const sdhi_control_t control = sdhi.controls[i];
+    accumulators[i] = 0;
     switch(control.type) {
     case SDHI_CONTROL_TYPE_INTEGER:
       values[control.id] = control.configuration.integer.initial;
@@ -152,33 +268,188 @@ float sdhi_real(const uint16_t id, const int32_t * const values, const sdhi_t sd
 }
 
 int32_t sdhi_enumeration(const uint16_t id, const int32_t * const values, const sdhi_t sdhi) {
-  return find_control(id, sdhi)->configuration.enumeration.values[(uint32_t)(values[id] & 0xFFFFFF)].value;
+  return find_control(id, sdhi)->configuration.enumeration.values[values[id]].value;
+}
+
+bool sdhi_stored_value(const uint16_t id, const int32_t value, int32_t * const stored, const sdhi_t sdhi) {
+  const sdhi_control_t * const control = find_control(id, sdhi);
+  switch(control->type) {
+  case SDHI_CONTROL_TYPE_INTEGER:
+    *stored = update(value, 0, control->configuration.integer.min, control->configuration.integer.max);
+    return true;
+  case SDHI_CONTROL_TYPE_ENUMERATION:
+    for(uint16_t i = 0; i < control->configuration.enumeration.size; i++) {
+      if(control->configuration.enumeration.values[i].value == value) {
+        *stored = i;
+        return true;
+      }
+    }
+    return false;
+  case SDHI_CONTROL_TYPE_REAL:
+    return false;
+  }
+  return false;
+}
+
+int32_t sdhi_clamp_value(const uint16_t id, const int32_t value, const sdhi_t sdhi) {
+  const sdhi_control_t * const control = find_control(id, sdhi);
+  if(control == NULL) {
+    return value;
+  }
+  const sdhi_scale_t * const scale = control_scale(control, sdhi);
+  return update(value, 0, scale->min, scale->max);
+}
+
+static uint32_t hash(const uint32_t sum, const uint32_t word) {
+  return (sum ^ word) * 16777619u;
+}
+
+uint32_t sdhi_hash(const sdhi_t sdhi) {
+  uint32_t sum = hash(2166136261u, sdhi.controls_size);
+  for(uint32_t i = 0; i < sdhi.controls_size; i++) {
+    const sdhi_control_t * const control = &sdhi.controls[i];
+    const sdhi_scale_t * const scale = control_scale(control, sdhi);
+    sum = hash(sum, control->id);
+    sum = hash(sum, control->type);
+    sum = hash(sum, scale->min);
+    sum = hash(sum, scale->max);
+    sum = hash(sum, scale->step);
+    if(control->type == SDHI_CONTROL_TYPE_ENUMERATION) {
+      for(uint16_t j = 0; j < control->configuration.enumeration.size; j++) {
+        sum = hash(sum, control->configuration.enumeration.values[j].value);
+      }
+    }
+  }
+  return sum;
+}
+
+#define NO_DISPLAY 0xFF
+
+// Displays making up one slot of the faceplate. Slots on the same row
+// share their edge displays, and the bottom row of a slot is the top
+// row of the slot below. start and end are the separator displays
+// between the two rows, NO_DISPLAY if the geometry has none.
+typedef struct {
+  uint8_t top_start;
+  uint8_t top;
+  uint8_t top_end;
+  uint8_t start;
+  uint8_t end;
+  uint8_t bottom_start;
+  uint8_t bottom;
+  uint8_t bottom_end;
+  int16_t control;
+} sdhi_slot_t;
+
+static sdhi_slot_t slots[SDHI_MAX_SLOTS];
+
+static uint8_t slot_index(const uint8_t x, const uint8_t y) {
+  return y * geometry.columns + x;
+}
+
+static const sdhi_slot_t * const slot(const uint8_t x, const uint8_t y) {
+  return &slots[slot_index(x, y)];
+}
+
+// Counted in 32 bits, a large geometry can have more displays than
+// fit in a display index
+static uint32_t row_displays(const sdhi_geometry_t geometry) {
+  return (uint32_t)geometry.columns * geometry.slot_width + 1;
+}
+
+static uint32_t band_displays(const sdhi_geometry_t geometry) {
+  return row_displays(geometry) + (geometry.separators ? geometry.columns + 1 : 0);
+}
+
+static uint32_t displays(const sdhi_geometry_t geometry) {
+  return geometry.rows * band_displays(geometry) + row_displays(geometry);
+}
+
+uint8_t sdhi_displays(const sdhi_geometry_t geometry) {
+  if(displays(geometry) > PIO_DISPLAY_MAX_DISPLAYS) {
+    panic("SDHI geometry needs %lu displays, more than %d!", (unsigned long)displays(geometry), PIO_DISPLAY_MAX_DISPLAYS);
+  }
+  return displays(geometry);
+}
+
+static void init_slots(const sdhi_geometry_t geometry) {
+  const uint8_t band = band_displays(geometry);
+  int16_t control = 0;
+  for(uint8_t y = 0; y < geometry.rows; y++) {
+    for(uint8_t x = 0; x < geometry.columns; x++) {
+      sdhi_slot_t * const s = &slots[slot_index(x, y)];
+      s->top_start = x * geometry.slot_width + y * band;
+      s->top = s->top_start + geometry.slot_width / 2;
+      s->top_end = s->top_start + geometry.slot_width;
+      s->bottom_start = s->top_start + band;
+      s->bottom = s->top + band;
+      s->bottom_end = s->top_end + band;
+      if(geometry.separators) {
+        s->start = x + y * band + row_displays(geometry);
+        s->end = s->start + 1;
+      } else {
+        s->start = NO_DISPLAY;
+        s->end = NO_DISPLAY;
+      }
+      if(x == geometry.selector_x && y == geometry.selector_y) {
+        s->control = -1;
+      } else {
+        s->control = control++;
+      }
+    }
+  }
+}
+
+static void HOT_PATH(draw_rows)(const uint8_t first, const uint8_t last) {
+  for(uint8_t i = first; i <= last; i++) {
+    draw_row(pio_display_get(i));
+  }
+}
+
+static void HOT_PATH(draw_borders)(const sdhi_slot_t * const s, const bool top, const bool bottom, const bool start, const bool end) {
+  if(top) {
+    draw_right_row(pio_display_get(s->top_start));
+    draw_rows(s->top_start + 1, s->top_end - 1);
+    draw_left_row(pio_display_get(s->top_end));
+  }
+
+  if(bottom) {
+    draw_right_row(pio_display_get(s->bottom_start));
+    draw_rows(s->bottom_start + 1, s->bottom_end - 1);
+    draw_left_row(pio_display_get(s->bottom_end));
+  }
+
+  if(start) {
+    draw_lower_column(pio_display_get(s->top_start));
+    if(s->start != NO_DISPLAY) {
+      draw_row(pio_display_get(s->start));
+    }
+    draw_upper_column(pio_display_get(s->bottom_start));
+  }
+
+  if(end) {
+    draw_lower_column(pio_display_get(s->top_end));
+    if(s->end != NO_DISPLAY) {
+      draw_row(pio_display_get(s->end));
+    }
+    draw_upper_column(pio_display_get(s->bottom_end));
+  }
 }
 
-static void draw_control(const sdhi_control_t * const control, const uint8_t x, const uint8_t y, const int32_t top_group, const int32_t bottom_group, const int32_t start_group, const int32_t end_group, const int32_t * const values) {
+static void HOT_PATH(draw_control)(const sdhi_control_t * const control, const sdhi_scale_t * const scale, const sdhi_slot_t * const s, const int32_t top_group, const int32_t bottom_group, const int32_t start_group, const int32_t end_group, const int32_t * const values) {
   int32_t group = -1;
-  uint8_t top_start = x * 2 + y * 11;
-  uint8_t top = x * 2 + 1 + y * 11;
-  uint8_t top_end = x * 2 + 2 + y * 11;
-  uint8_t start = x + y * 11 + 7;
-  uint8_t end = x + 1 + y * 11 + 7;
-  uint8_t bottom_start = x * 2 + (y + 1) * 11;
-  uint8_t bottom = x * 2 + 1 + (y + 1) * 11;
-  uint8_t bottom_end = x * 2 + 2 + (y + 1) * 11;
 
   if(control != NULL) {
     group = control->group;
-    pio_display_print_center(pio_display_get(top), 0, SIZE_13, true, control->title);
+    pio_display_print_center(pio_display_get(s->top), 0, SIZE_13, true, control->title);
     switch(control->type) {
     case SDHI_CONTROL_TYPE_INTEGER: {
-      char value[16];
-      snprintf(value, 16, "%d", values[control->id]);
-      pio_display_print_center(pio_display_get(bottom), 63 - 13 - 8, SIZE_13, true, value);
-      int32_t min = control->configuration.integer.min;
-      int32_t max = control->configuration.integer.max;
-
-      uint32_t total = (uint8_t)((float)(values[control->id] - min) / (float)(max - min) * 96);
-      uint32_t middle = (uint8_t)((float)(control->configuration.integer.middle - min) / (float)(max - min) * 96);
+      uint8_t value[FORMAT_MAX_SIZE];
+      const uint8_t size = format_integer(value, values[control->id]);
+      pio_display_print_glyphs_center(pio_display_get(s->bottom), 63 - 13 - 8, SIZE_13, true, value, size);
+
+      uint32_t total = bar_position(scale, values[control->id]);
+      uint32_t middle = scale->middle;
       uint32_t start;
       uint32_t end;
       if(values[control->id] <= control->configuration.integer.middle) {
@@ -188,112 +459,260 @@ static void draw_control(const sdhi_control_t * const control, const uint8_t x,
         start = 17 + middle;
         end = 17 + total;
       }
-      pio_display_fill_rectangle(pio_display_get(bottom), start, 63 - 4, end, 63);
+      pio_display_fill_rectangle(pio_display_get(s->bottom), start, 63 - 4, end, 63);
       break;
     }
     case SDHI_CONTROL_TYPE_REAL: {
-      char value[16];
-      snprintf(value, 16, "%.2f", values[control->id] * control->configuration.real.step);
-      pio_display_print_center(pio_display_get(bottom), 63 - 13 - 8, SIZE_13, true, value);
-      int32_t min = (int32_t)(control->configuration.real.min / control->configuration.real.step);
-      int32_t max = (int32_t)(control->configuration.real.max / control->configuration.real.step);
-      pio_display_fill_rectangle(pio_display_get(bottom), 16, 63 - 4, 16 + (uint8_t)((float)(values[control->id] - min) / (float)(max - min) * 96), 63);
+      uint8_t value[FORMAT_MAX_SIZE];
+      const uint8_t size = format_fixed(value, real_hundredths(scale, values[control->id]), REAL_DECIMALS);
+      pio_display_print_glyphs_center(pio_display_get(s->bottom), 63 - 13 - 8, SIZE_13, true, value, size);
+      pio_display_fill_rectangle(pio_display_get(s->bottom), 16, 63 - 4, 16 + bar_position(scale, values[control->id]), 63);
       break;
     }
     case SDHI_CONTROL_TYPE_ENUMERATION:
-      pio_display_print_center(pio_display_get(bottom), 63 - 13, SIZE_13, true, control->configuration.enumeration.values[(uint32_t)(values[control->id] & 0xFFFFFF)].name);
+      pio_display_print_center(pio_display_get(s->bottom), 63 - 13, SIZE_13, true, control->configuration.enumeration.values[values[control->id]].name);
       break;
     }
   }
 
-  if(group != top_group) {
-    draw_right_row(pio_display_get(top_start));
-    draw_row(pio_display_get(top));
-    draw_left_row(pio_display_get(top_end));
-  }
+  draw_borders(s, group != top_group, group != bottom_group, group != start_group, group != end_group);
+}
 
-  if(group != bottom_group) {
-    draw_right_row(pio_display_get(bottom_start));
-    draw_row(pio_display_get(bottom));
-    draw_left_row(pio_display_get(bottom_end));
-  }
+static void HOT_PATH(draw_panel_control)(const sdhi_t sdhi) {
+  const sdhi_slot_t * const s = slot(geometry.selector_x, geometry.selector_y);
+
+  pio_display_print_center(pio_display_get(s->top), 0, SIZE_13, true, sdhi.panel_selector_title);
+  pio_display_print_center(pio_display_get(s->bottom), 63 - 13, SIZE_13, true, sdhi.panels[current_panel].title);
+  pio_display_print_center(pio_display_get(s->bottom), 63 - 26, SIZE_13, true, sdhi.panels[current_panel].subtitle);
 
-  if(group != start_group) {
-    draw_lower_column(pio_display_get(top_start));
-    draw_row(pio_display_get(start));
-    draw_upper_column(pio_display_get(bottom_start));
+  draw_borders(s, true, true, true, true);
+}
+
+static int32_t HOT_PATH(panel_control_id)(const sdhi_slot_t * const s, const sdhi_t sdhi) {
+  if(s->control < 0 || s->control >= SDHI_PANEL_CONTROLS) {
+    return -1;
   }
+  return sdhi.panels[current_panel].controls[s->control];
+}
 
-  if(group != end_group) {
-    draw_lower_column(pio_display_get(top_end));
-    draw_row(pio_display_get(end));
-    draw_upper_column(pio_display_get(bottom_end));
+static int32_t HOT_PATH(find_group)(int8_t x, int8_t y, const sdhi_t sdhi) {
+  if(x < 0 || y < 0 || x >= geometry.columns || y >= geometry.rows) {
+    return -1;
+  } else {
+    int32_t control_id = panel_control_id(slot(x, y), sdhi);
+    if(control_id == -1) {
+      return control_id;
+    } else {
+      return find_control(control_id, sdhi)->group;
+    }
   }
+}
 
+static void HOT_PATH(draw_control_slot)(const uint8_t x, const uint8_t y, const int32_t * const values, const sdhi_t sdhi) {
+  const sdhi_slot_t * const s = slot(x, y);
+  const sdhi_control_t * const control = find_control(panel_control_id(s, sdhi), sdhi);
+  const int32_t top_group = find_group(x, y - 1, sdhi);
+  const int32_t bottom_group = find_group(x, y + 1, sdhi);
+  const int32_t start_group = find_group(x - 1, y, sdhi);
+  const int32_t end_group = find_group(x + 1, y, sdhi);
+  const sdhi_scale_t * const scale = control == NULL ? NULL : control_scale(control, sdhi);
+  draw_control(control, scale, s, top_group, bottom_group, start_group, end_group, values);
 }
 
-static void draw_panel_control(const sdhi_t sdhi) {
-  uint8_t top_start = 2 * 2 + 2 * 11;
-  uint8_t top = 2 * 2 + 1 + 2 * 11;
-  uint8_t top_end = 2 * 2 + 2 + 2 * 11;
-  uint8_t start = 2 + 2 * 11 + 7;
-  uint8_t end = 2 + 1 + 2 * 11 + 7;
-  uint8_t bottom_start = 2 * 2 + (2 + 1) * 11;
-  uint8_t bottom = 2 * 2 + 1 + (2 + 1) * 11;
-  uint8_t bottom_end = 2 * 2 + 2 + (2 + 1) * 11;
+typedef enum {
+  RENDER_CONTROL,
+  RENDER_PANEL_CONTROL
+} render_item_type_t;
+
+typedef struct {
+  render_item_type_t type;
+  uint8_t x;
+  uint8_t y;
+  uint8_t wait;
+} render_item_t;
+
+#define RENDER_MAX_ITEMS SDHI_MAX_SLOTS
+
+// Work items of a full frame. A control slot shares displays with its 8
+// neighbours, so slots are split in stages by the parity of x and y.
+// Items in the same stage never touch the same display. wait is the
+// number of items that must be finished before the item may start, i.e.
+// the index of the first item of its stage.
+static render_item_t render_items[RENDER_MAX_ITEMS];
+static uint8_t render_items_size;
+// Items of the frame being rendered, pulled by both cores. The size is
+// only changed under render_mutex.
+static render_item_t frame_items[RENDER_MAX_ITEMS];
+static uint8_t frame_items_size;
+
+static void add_render_item(const render_item_type_t type, const uint8_t x, const uint8_t y, const uint8_t wait) {
+  const render_item_t item = {type, x, y, wait};
+  render_items[render_items_size++] = item;
+}
 
-  pio_display_print_center(pio_display_get(top), 0, SIZE_13, true, sdhi.panel_selector_title);
-  pio_display_print_center(pio_display_get(bottom), 63 - 13, SIZE_13, true, sdhi.panels[current_panel].title);
-  pio_display_print_center(pio_display_get(bottom), 63 - 26, SIZE_13, true, sdhi.panels[current_panel].subtitle);
+static void init_render_items(const sdhi_geometry_t geometry) {
+  render_items_size = 0;
+  for(uint8_t stage = 0; stage < 4; stage++) {
+    const uint8_t wait = render_items_size;
+    for(uint8_t y = stage / 2; y < geometry.rows; y += 2) {
+      for(uint8_t x = stage % 2; x < geometry.columns; x += 2) {
+        if(x == geometry.selector_x && y == geometry.selector_y) {
+          add_render_item(RENDER_PANEL_CONTROL, x, y, wait);
+        } else {
+          add_render_item(RENDER_CONTROL, x, y, wait);
+        }
+      }
+    }
+  }
+}
 
-  draw_right_row(pio_display_get(top_start));
-  draw_row(pio_display_get(top));
-  draw_left_row(pio_display_get(top_end));
+auto_init_mutex(render_mutex);
+static volatile uint8_t render_next;
+static volatile uint8_t render_done;
+static const int32_t * render_values;
+static const sdhi_t * render_sdhi;
+
+static int16_t render_take() {
+  int16_t item = -1;
+  mutex_enter_blocking(&render_mutex);
+  if(render_next < frame_items_size && render_done >= frame_items[render_next].wait) {
+    item = render_next;
+    render_next++;
+  }
+  mutex_exit(&render_mutex);
+  return item;
+}
 
-  draw_right_row(pio_display_get(bottom_start));
-  draw_row(pio_display_get(bottom));
-  draw_left_row(pio_display_get(bottom_end));
+static void render_finish() {
+  mutex_enter_blocking(&render_mutex);
+  render_done++;
+  mutex_exit(&render_mutex);
+}
 
-  draw_lower_column(pio_display_get(top_start));
-  draw_row(pio_display_get(start));
-  draw_upper_column(pio_display_get(bottom_start));
+static void HOT_PATH(render)(const render_item_t item, const int32_t * const values, const sdhi_t sdhi) {
+  switch(item.type) {
+  case RENDER_CONTROL:
+    draw_control_slot(item.x, item.y, values, sdhi);
+    break;
+  case RENDER_PANEL_CONTROL:
+    draw_panel_control(sdhi);
+    break;
+  }
+}
 
-  draw_lower_column(pio_display_get(top_end));
-  draw_row(pio_display_get(end));
-  draw_upper_column(pio_display_get(bottom_end));
+static bool HOT_PATH(render_run)() {
+  const int16_t item = render_take();
+  if(item < 0) {
+    return false;
+  }
+  render(frame_items[item], render_values, *render_sdhi);
+  render_finish();
+  return true;
+}
 
+// Called from the core 1 loop, draws at most one item so I/O latency stays bounded
+void HOT_PATH(sdhi_render_run)() {
+  render_run();
 }
 
-static uint8_t control_index(uint8_t x, uint8_t y) {
-  return y * 3 + x;
+static bool draws_on(const sdhi_slot_t * const s, const uint8_t display) {
+  return (display >= s->top_start && display <= s->top_end) ||
+    (display >= s->bottom_start && display <= s->bottom_end) ||
+    display == s->start || display == s->end;
 }
 
-static int32_t find_group(int8_t x, int8_t y, const sdhi_t sdhi) {
-  if(x < 0 || y < 0 || x > 2 || y > 2 || (x == 2 && y == 2)) {
-    return -1;
-  } else {
-    int32_t control_id = sdhi.panels[current_panel].controls[control_index(x, y)];
-    if(control_id == -1) {
-      return control_id;
-    } else {
-      return find_control(control_id, sdhi)->group;
+// The display is cleared and every slot drawing on it redrawn, in both
+// framebuffers
+static void mark_display(const uint8_t display) {
+  stale_displays[display] = FRAMEBUFFERS;
+  for(uint8_t i = 0; i < geometry.rows * geometry.columns; i++) {
+    if(draws_on(&slots[i], display)) {
+      stale_slots[i] = FRAMEBUFFERS;
+    }
+  }
+}
+
+// The value of a control is drawn on the bottom display of its slot
+static void mark_control(const int32_t id, const sdhi_t sdhi) {
+  for(uint8_t i = 0; i < geometry.rows * geometry.columns; i++) {
+    if(panel_control_id(&slots[i], sdhi) == id) {
+      mark_display(slots[i].bottom);
+    }
+  }
+}
+
+// Picks the items of the next frame, all of them or only the stale slots.
+// Stale slots are drawn over what the frame before left in this
+// framebuffer. Drawing only sets pixels, so redrawing a slot leaves its
+// unchanged displays as they were. Returns the number of items, which
+// core 1 must not see before they are written.
+static uint8_t select_frame_items(const bool all) {
+  uint8_t size = 0;
+  uint8_t wait = 0;
+  for(uint8_t i = 0; i < render_items_size; i++) {
+    render_item_t item = render_items[i];
+    uint8_t * const stale = &stale_slots[slot_index(item.x, item.y)];
+    if(*stale > 0) {
+      (*stale)--;
+    } else if(!all) {
+      continue;
+    }
+    // A stage starts where it started in the full frame
+    if(i > 0 && item.wait != render_items[i - 1].wait) {
+      wait = size;
     }
+    item.wait = wait;
+    frame_items[size++] = item;
   }
+  for(uint8_t i = 0; i < PIO_DISPLAY_MAX_DISPLAYS; i++) {
+    if(stale_displays[i] > 0) {
+      stale_displays[i]--;
+      if(!all) {
+        pio_display_clear(pio_display_get(i));
+      }
+    }
+  }
+  return size;
 }
 
 void sdhi_update_displays(const int32_t * const values, const sdhi_t sdhi) {
-  pio_display_clear_current_framebuffer();
-  const sdhi_panel_t panel = sdhi.panels[current_panel];
-  for(uint8_t x = 0; x < 3; x++) {
-    for(uint8_t y = 0; control_index(x, y) < 8; y++) {
-      uint8_t i = control_index(x, y);
-      const sdhi_control_t * const control = find_control(sdhi.panels[current_panel].controls[i], sdhi);
-      const int32_t top_group = find_group(x, y - 1, sdhi);
-      const int32_t bottom_group = find_group(x, y + 1, sdhi);
-      const int32_t start_group = find_group(x - 1, y, sdhi);
-      const int32_t end_group = find_group(x + 1, y, sdhi);
-      draw_control(control, x, y, top_group, bottom_group, start_group, end_group, values);
+  for(int32_t id = value_next(VALUE_CONSUMER_RENDER); id != VALUE_NONE; id = value_next(VALUE_CONSUMER_RENDER)) {
+    if(id == VALUE_ALL) {
+      stale_frames = FRAMEBUFFERS;
+    } else {
+      mark_control(id, sdhi);
+    }
+  }
+  // A display that stopped scrolling lost what was drawn meanwhile
+  for(uint8_t i = 0; i < displays(geometry); i++) {
+    if(pio_display_redraw(i)) {
+      mark_display(i);
+    }
+  }
+  uint8_t size;
+  if(stale_frames > 0) {
+    stale_frames--;
+    size = select_frame_items(true);
+    // The framebuffer is cleared by DMA while the first slots are drawn
+    pio_display_clear_current_framebuffer();
+  } else {
+    size = select_frame_items(false);
+    if(size == 0) {
+      return;
+    }
+  }
+
+  mutex_enter_blocking(&render_mutex);
+  frame_items_size = size;
+  render_values = values;
+  render_sdhi = &sdhi;
+  render_done = 0;
+  render_next = 0;
+  mutex_exit(&render_mutex);
+
+  while(render_done < frame_items_size) {
+    if(!render_run()) {
+      tight_loop_contents();
     }
   }
-  draw_panel_control(sdhi);
 }
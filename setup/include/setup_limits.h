@@ -0,0 +1,7 @@
+#pragma once
+
+// Sizes of the static tables holding a setup. Control ids index the
+// value array, so there is one value per control.
+#define SETUP_MAX_CONTROLS 256
+#define SETUP_MAX_VALUES SETUP_MAX_CONTROLS
+#define SETUP_MAX_ACTIONS 256
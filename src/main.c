@@ -4,42 +4,115 @@
 #include "pico/multicore.h"
 #include "pio_display.h"
 #include "i2c_controller.h"
+#include "pio_encoder.h"
 #include "sdhi.h"
 #include "midi.h"
+#include "usb_midi.h"
 #include "action.h"
 #include "drum.h"
+#include "trace.h"
+#include "preset.h"
+#include "value.h"
+#include "scheduler.h"
+
+// Preset holding the working state, restored at boot
+#define WORKING_PRESET 0
+#define AUTOSAVE_DELAY_US 2000000
+
+static const sdhi_geometry_t geometry = {
+  .columns = 3,
+  .rows = 3,
+  .slot_width = 2,
+  .separators = true,
+  .selector_x = 2,
+  .selector_y = 2
+};
+
+// Core 1 tasks. MIDI is served every byte time of the wire, encoders
+// are scanned every millisecond and rendering takes the time left.
+static const scheduler_task_t tasks[] = {
+  {.name = "midi", .run = midi_run, .period_us = 320, .deadline_us = 320},
+  {.name = "encoders", .run = i2c_controller_run, .period_us = 1000, .deadline_us = 1000},
+  {.name = "render", .run = sdhi_render_run}
+};
 
 static void real_time() {
-  for(uint32_t i = 0;;i++) {
-    i2c_controller_run();
-    midi_run();
+  multicore_lockout_victim_init();
+  scheduler_init(tasks, sizeof(tasks) / sizeof(tasks[0]));
+  for(;;) {
+    trace_period(TRACE_CORE1_LOOP);
+    scheduler_run();
   }
 }
 
 int main() {
   stdio_init_all();
+  usb_midi_init();
   printf("SDHI\n");
-  pio_display_init();
+  trace_init();
+  pio_display_init(sdhi_displays(geometry));
+  trace_boot(TRACE_BOOT_DISPLAY_INIT);
   i2c_controller_init();
+  pio_encoder_init();
   setup_t drums = drum_init();
 
-  sdhi_init(drums.sdhi);
+  sdhi_init(drums.sdhi, geometry);
   sdhi_init_values(drums.values, drums.sdhi);
+  value_init(drums.values, drums.sdhi.controls_size);
+  preset_init(drums.sdhi);
+  preset_recall(WORKING_PRESET, drums.values, drums.sdhi);
+  value_consume_all(VALUE_CONSUMER_PRESET);
+  trace_boot(TRACE_BOOT_SETUP);
   midi_init();
   multicore_launch_core1(real_time);
+  trace_boot(TRACE_BOOT_CORE1);
 
-  pio_display_update_and_flip();
+  // The displays only accept data 100 ms after power on. Start the MIDI
+  // dump and render the first frame meanwhile, the main loop sends the
+  // rest of the dump while the panel is already live.
+  bool actions_pending = action_init(drums.actions, drums.sdhi, drums.values, drums.action_values);
   sdhi_update_displays(drums.values, drums.sdhi);
-  action_init(drums.actions, drums.sdhi, drums.values, drums.action_values);
 
+  bool modified = false;
+  uint32_t modified_time = 0;
   for(uint32_t i = 0;;) {
     if(pio_display_can_wait_without_blocking()) {
       pio_display_wait_for_finish_blocking();
+      uint32_t begin = trace_begin();
       pio_display_update_and_flip();
+      trace_end(TRACE_UPDATE_AND_FLIP, begin);
+      trace_boot(TRACE_BOOT_FIRST_FRAME);
+      trace_frame();
+      // The frame is sent by DMA from RAM, so this is where a flash write
+      // stalling XIP costs the least
+      if(preset_pending() && midi_idle()) {
+        preset_run();
+      }
+      begin = trace_begin();
       sdhi_update_displays(drums.values, drums.sdhi);
+      trace_end(TRACE_UPDATE_DISPLAYS, begin);
+    }
+    if(action_receive(drums.actions, drums.sdhi, drums.values, drums.action_values)) {
+      actions_pending = true;
+    }
+    uint32_t begin = trace_begin();
+    sdhi_update_values(drums.values, drums.sdhi);
+    trace_end(TRACE_UPDATE_VALUES, begin);
+    if(value_changed(VALUE_CONSUMER_ACTION) || actions_pending) {
+      begin = trace_begin();
+      actions_pending = action_update(drums.actions, drums.sdhi, drums.values, drums.action_values);
+      trace_end(TRACE_ACTION_UPDATE, begin);
+    } else if(midi_idle()) {
+      trace_boot(TRACE_BOOT_MIDI_DUMP);
+    }
+    if(value_changed(VALUE_CONSUMER_PRESET)) {
+      value_consume_all(VALUE_CONSUMER_PRESET);
+      modified = true;
+      modified_time = time_us_32();
     }
-    if(sdhi_update_values(drums.values, drums.sdhi)) {
-      action_update(drums.actions, drums.sdhi, drums.values, drums.action_values);
+    if(modified && time_us_32() - modified_time > AUTOSAVE_DELAY_US) {
+      modified = !preset_store(WORKING_PRESET, drums.values);
     }
+    trace_poll();
   }
 }
@@ -0,0 +1,163 @@
+#include <string.h>
+#include "display_chain.h"
+
+void display_chain_init(display_chain_t * const chain, const uint16_t displays) {
+  chain->displays = displays;
+  chain->cs = true;
+  chain->pins = 0;
+  for(uint16_t i = 0; i < DISPLAY_CHAIN_MAX_DISPLAYS; i++) {
+    // Shift register contents are undefined at power on
+    chain->selected[i] = false;
+    display_controller_t * const controller = &chain->controllers[i];
+    memset(controller, 0, sizeof(*controller));
+    controller->contrast = 0x7F;
+  }
+}
+
+// RESET resets the controllers and clears the shift register, which
+// selects every display so they can be initialized all at once
+void display_chain_reset(display_chain_t * const chain) {
+  for(uint16_t i = 0; i < chain->displays; i++) {
+    chain->selected[i] = true;
+    display_controller_t * const controller = &chain->controllers[i];
+    memset(controller, 0, sizeof(*controller));
+    controller->contrast = 0x7F;
+  }
+}
+
+void display_chain_set_cs(display_chain_t * const chain, const bool cs) {
+  chain->cs = cs;
+}
+
+void display_chain_reset_statistics(display_chain_t * const chain) {
+  for(uint16_t i = 0; i < chain->displays; i++) {
+    chain->controllers[i].command_bytes = 0;
+    chain->controllers[i].data_bytes = 0;
+    chain->controllers[i].unknown_commands = 0;
+  }
+}
+
+// Number of argument bytes following a command byte
+static uint8_t command_arguments(const uint8_t command) {
+  switch(command) {
+  case 0x20: case 0x81: case 0x8D: case 0xA8: case 0xD3:
+  case 0xD5: case 0xD9: case 0xDA: case 0xDB: case 0xAD:
+    return 1;
+  case 0x21: case 0x22: case 0xA3:
+    return 2;
+  case 0x29: case 0x2A:
+    return 5;
+  case 0x26: case 0x27:
+    return 6;
+  default:
+    return 0;
+  }
+}
+
+static void execute_command(display_controller_t * const controller) {
+  const uint8_t command = controller->command[0];
+  if(command <= 0x0F) {
+    controller->column = (controller->column & 0xF0) | command;
+  } else if(command <= 0x1F) {
+    controller->column = (controller->column & 0x0F) | ((command & 0x0F) << 4);
+  } else if(command >= 0xB0 && command <= 0xB7) {
+    controller->page = command & 0x07;
+  } else if(command >= 0x40 && command <= 0x7F) {
+    // Display start line, not modelled
+  } else {
+    switch(command) {
+    case 0x81:
+      controller->contrast = controller->command[1];
+      break;
+    case 0xA6:
+      controller->inverse = false;
+      break;
+    case 0xA7:
+      controller->inverse = true;
+      break;
+    case 0xAE:
+      controller->on = false;
+      break;
+    case 0xAF:
+      controller->on = true;
+      break;
+    case 0x2E:
+      controller->scrolling = false;
+      break;
+    case 0x2F:
+      controller->scrolling = true;
+      break;
+    case 0x20: case 0x21: case 0x22: case 0x26: case 0x27: case 0x29: case 0x2A:
+    case 0x8D: case 0xA0: case 0xA1: case 0xA3: case 0xA4: case 0xA5: case 0xA8:
+    case 0xAD: case 0xC0: case 0xC8: case 0xD3: case 0xD5: case 0xD9: case 0xDA:
+    case 0xDB: case 0xE3:
+      break;
+    default:
+      controller->unknown_commands++;
+      break;
+    }
+  }
+}
+
+static void receive_byte(display_controller_t * const controller, const uint8_t byte, const bool data) {
+  if(data) {
+    controller->data_bytes++;
+    controller->ram[controller->page][controller->column % DISPLAY_RAM_COLUMNS] = byte;
+    controller->column = (controller->column + 1) % DISPLAY_RAM_COLUMNS;
+    return;
+  }
+  controller->command_bytes++;
+  if(controller->command_size == 0) {
+    controller->command_expected = 1 + command_arguments(byte);
+  }
+  controller->command[controller->command_size++] = byte;
+  if(controller->command_size == controller->command_expected) {
+    execute_command(controller);
+    controller->command_size = 0;
+  }
+}
+
+static bool rising(const uint32_t before, const uint32_t after, const uint8_t pin) {
+  return !((before >> pin) & 1) && ((after >> pin) & 1);
+}
+
+void display_chain_pins_changed(void * const context, const uint32_t pins) {
+  display_chain_t * const chain = context;
+  const uint32_t before = chain->pins;
+  chain->pins = pins;
+
+  if(rising(before, pins, chain->shift_cs_pin)) {
+    for(uint16_t i = chain->displays - 1; i > 0; i--) {
+      chain->selected[i] = chain->selected[i - 1];
+    }
+    chain->selected[0] = !chain->cs;
+    // Deselecting a display restarts its byte framing
+    for(uint16_t i = 0; i < chain->displays; i++) {
+      if(!chain->selected[i]) {
+        chain->controllers[i].bits = 0;
+      }
+    }
+  }
+
+  if(rising(before, pins, chain->sclk_pin)) {
+    const uint8_t bit = (pins >> chain->mosi_pin) & 1;
+    const bool data = (pins >> chain->dc_pin) & 1;
+    for(uint16_t i = 0; i < chain->displays; i++) {
+      if(!chain->selected[i]) {
+        continue;
+      }
+      display_controller_t * const controller = &chain->controllers[i];
+      controller->byte = (controller->byte << 1) | bit;
+      controller->bits++;
+      if(controller->bits == 8) {
+        receive_byte(controller, controller->byte, data);
+        controller->bits = 0;
+      }
+    }
+  }
+}
+
+bool display_chain_pixel(const display_chain_t * const chain, const uint16_t display, const uint8_t x, const uint8_t y) {
+  const display_controller_t * const controller = &chain->controllers[display];
+  return (controller->ram[y / 8][x + chain->column_offset] >> (y % 8)) & 1;
+}
@@ -0,0 +1,52 @@
+#pragma once
+#include <stdint.h>
+#include <stdbool.h>
+
+#define DISPLAY_CHAIN_MAX_DISPLAYS 128
+#define DISPLAY_RAM_COLUMNS 132
+#define DISPLAY_PAGES 8
+#define DISPLAY_WIDTH 128
+#define DISPLAY_HEIGHT 64
+
+// SSD1306/SH1106 style controller state, enough to follow the commands
+// sent by pio_display and to reconstruct what the panel shows
+typedef struct {
+  uint8_t ram[DISPLAY_PAGES][DISPLAY_RAM_COLUMNS];
+  uint8_t page;
+  uint8_t column;
+  uint8_t byte;
+  uint8_t bits;
+  bool data;
+  uint8_t command[8];
+  uint8_t command_size;
+  uint8_t command_expected;
+  uint8_t contrast;
+  bool on;
+  bool inverse;
+  bool scrolling;
+  uint32_t command_bytes;
+  uint32_t data_bytes;
+  uint32_t unknown_commands;
+} display_controller_t;
+
+typedef struct {
+  uint8_t cs_pin;
+  uint8_t shift_cs_pin;
+  uint8_t dc_pin;
+  uint8_t mosi_pin;
+  uint8_t sclk_pin;
+  uint8_t column_offset;
+  uint16_t displays;
+  // Output of each shift register stage, low selects the display
+  bool selected[DISPLAY_CHAIN_MAX_DISPLAYS];
+  bool cs;
+  uint32_t pins;
+  display_controller_t controllers[DISPLAY_CHAIN_MAX_DISPLAYS];
+} display_chain_t;
+
+void display_chain_init(display_chain_t * const chain, const uint16_t displays);
+void display_chain_reset(display_chain_t * const chain);
+void display_chain_set_cs(display_chain_t * const chain, const bool cs);
+void display_chain_pins_changed(void * const context, const uint32_t pins);
+bool display_chain_pixel(const display_chain_t * const chain, const uint16_t display, const uint8_t x, const uint8_t y);
+void display_chain_reset_statistics(display_chain_t * const chain);
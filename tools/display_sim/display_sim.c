@@ -0,0 +1,330 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "pio_display.h"
+#include "pio_sim.h"
+#include "display_chain.h"
+#include "fake_sdk.h"
+
+// Runs the real pio_display driver against a simulation of spi.pio and
+// the SHIFT_CS display chains. A distinct pattern is drawn on every
+// display, one frame is sent, and the images decoded from the wire are
+// compared with what was drawn. Then controller commands are sent to a
+// few displays and checked to reach only those, and a tile is copied
+// into one display by the DMA engine.
+
+#define DEFAULT_DISPLAYS 40
+#define DEFAULT_CS 20
+#define DEFAULT_RESET 26
+#define COMMAND_BYTES_PER_PAGE 4
+
+static display_chain_t chains[PIO_DISPLAY_MAX_CHAINS];
+static uint8_t chains_size;
+static uint16_t displays;
+static pio_sim_program_t program;
+
+static void usage(const char * const name) {
+  fprintf(stderr,
+          "usage: %s [-p spi.pio] [-n displays] [-k chains] [-c cs_pin] [-r reset_pin] [-o directory]\n"
+          "  -p  PIO source to simulate (default %s)\n"
+          "  -n  number of displays (default %d)\n"
+          "  -k  split the displays into this many parallel chains (default 1)\n"
+          "  -c  GPIO driving the first shift register stage (default %d)\n"
+          "  -r  GPIO resetting the displays and shift register (default %d)\n"
+          "  -o  write the decoded images as PBM files to directory\n",
+          name, SPI_PIO_PATH, DEFAULT_DISPLAYS, DEFAULT_CS, DEFAULT_RESET);
+}
+
+static const display_chain_t *locate(const uint16_t display, uint16_t * const index) {
+  uint16_t first = 0;
+  for(uint8_t i = 0; i < chains_size; i++) {
+    if(display < first + chains[i].displays) {
+      *index = display - first;
+      return &chains[i];
+    }
+    first += chains[i].displays;
+  }
+  return NULL;
+}
+
+static bool pixel(const uint16_t display, const uint8_t x, const uint8_t y) {
+  uint16_t index;
+  const display_chain_t * const chain = locate(display, &index);
+  return display_chain_pixel(chain, index, x, y);
+}
+
+static const display_controller_t *controller(const uint16_t display) {
+  uint16_t index;
+  return &locate(display, &index)->controllers[index];
+}
+
+static void pattern(const uint16_t display, uint8_t * const x0, uint8_t * const y0, uint8_t * const x1, uint8_t * const y1) {
+  *x0 = (display * 3) % 64;
+  *y0 = (display * 5) % 32;
+  *x1 = *x0 + 20 + display % 40;
+  *y1 = *y0 + 10 + display % 20;
+}
+
+static bool in_pattern(const uint16_t display, const uint8_t x, const uint8_t y) {
+  uint8_t x0, y0, x1, y1;
+  pattern(display, &x0, &y0, &x1, &y1);
+  return x >= x0 && x <= x1 && y >= y0 && y <= y1;
+}
+
+static void draw_display(const uint16_t display) {
+  uint8_t x0, y0, x1, y1;
+  pattern(display, &x0, &y0, &x1, &y1);
+  pio_display_fill_rectangle(pio_display_get(display), x0, y0, x1, y1);
+}
+
+static void draw() {
+  pio_display_clear_current_framebuffer();
+  for(uint16_t i = 0; i < displays; i++) {
+    draw_display(i);
+  }
+}
+
+static uint32_t verify(const uint16_t display) {
+  uint32_t mismatches = 0;
+  for(uint8_t y = 0; y < DISPLAY_HEIGHT; y++) {
+    for(uint8_t x = 0; x < DISPLAY_WIDTH; x++) {
+      if(pixel(display, x, y) != in_pattern(display, x, y)) {
+        mismatches++;
+      }
+    }
+  }
+  return mismatches;
+}
+
+static bool write_pbm(const char * const directory, const uint16_t display) {
+  char path[512];
+  snprintf(path, sizeof(path), "%s/display_%02u.pbm", directory, display);
+  FILE *f = fopen(path, "w");
+  if(f == NULL) {
+    fprintf(stderr, "%s: cannot write\n", path);
+    return false;
+  }
+  fprintf(f, "P1\n%d %d\n", DISPLAY_WIDTH, DISPLAY_HEIGHT);
+  for(int16_t y = DISPLAY_HEIGHT - 1; y >= 0; y--) {
+    for(uint8_t x = 0; x < DISPLAY_WIDTH; x++) {
+      fputc(pixel(display, x, y) ? '1' : '0', f);
+    }
+    fputc('\n', f);
+  }
+  fclose(f);
+  return true;
+}
+
+static void send_frame() {
+  for(uint8_t i = 0; i < chains_size; i++) {
+    display_chain_reset_statistics(&chains[i]);
+  }
+  draw();
+  pio_display_update_and_flip();
+  pio_display_wait_for_finish_blocking();
+}
+
+// Sends a frame redrawing only the displays asking for it, in this and
+// the next framebuffer, the way sdhi renders unchanged values
+static void send_redrawn_frame(uint8_t * const redraws) {
+  for(uint16_t i = 0; i < displays; i++) {
+    if(pio_display_redraw(i)) {
+      redraws[i] = 2;
+    }
+    if(redraws[i] > 0) {
+      redraws[i]--;
+      pio_display_clear(pio_display_get(i));
+      draw_display(i);
+    }
+  }
+  for(uint8_t i = 0; i < chains_size; i++) {
+    display_chain_reset_statistics(&chains[i]);
+  }
+  pio_display_update_and_flip();
+  pio_display_wait_for_finish_blocking();
+}
+
+// Inverts, dims and scrolls three displays, then stops the scroll. The
+// scrolling display must get no pixel data and keep scrolling until it
+// has been drawn again, which must then show in both framebuffers
+// without any further drawing. The others must be left alone.
+static bool check_commands() {
+  const uint16_t inverted = 0;
+  const uint16_t dimmed = displays / 2;
+  const uint16_t scrolled = displays - 1;
+  pio_display_invert(inverted, true);
+  pio_display_contrast(dimmed, 0x10);
+  pio_display_scroll(scrolled, true, 2, 5, 7);
+  const uint64_t begin = fake_sdk_time_ns();
+  send_frame();
+  const uint64_t frame_ns = fake_sdk_time_ns() - begin;
+  bool ok = true;
+  for(uint16_t i = 0; i < displays; i++) {
+    const display_controller_t * const c = controller(i);
+    ok = ok
+      && c->inverse == (i == inverted)
+      && c->contrast == (i == dimmed ? 0x10 : 0xFF)
+      && c->scrolling == (i == scrolled)
+      && c->data_bytes == (i == scrolled ? 0 : DISPLAY_PAGES * DISPLAY_WIDTH)
+      && c->unknown_commands == 0;
+  }
+  // The other framebuffer too, then both again after the scroll stops
+  send_frame();
+  ok = ok && controller(scrolled)->scrolling && controller(scrolled)->data_bytes == 0;
+  pio_display_scroll_stop(scrolled);
+  for(uint8_t i = 0; i < chains_size; i++) {
+    display_chain_reset_statistics(&chains[i]);
+  }
+  pio_display_update_and_flip();
+  pio_display_wait_for_finish_blocking();
+  ok = ok && controller(scrolled)->scrolling && controller(scrolled)->data_bytes == 0;
+  static uint8_t redraws[PIO_DISPLAY_MAX_DISPLAYS];
+  for(uint8_t i = 0; i < 4; i++) {
+    send_redrawn_frame(redraws);
+    ok = ok && !controller(scrolled)->scrolling && controller(scrolled)->data_bytes == DISPLAY_PAGES * DISPLAY_WIDTH && verify(scrolled) == 0;
+  }
+  printf("commands: %s, frame with one display scrolling %.1f us\n", ok ? "ok" : "FAIL", frame_ns / 1e3);
+  return ok;
+}
+
+// Copies a tile over one display, which must show the tile only for that
+// frame. The frames after it must be cleared of the tile in both
+// framebuffers.
+static bool check_copy() {
+  static uint8_t tile[PIO_DISPLAY_TILE_SIZE] __attribute__((aligned(4)));
+  const uint16_t copied = displays / 3;
+  pio_display_tile_init(tile);
+  pio_display_fill_rectangle(tile, 10, 10, 100, 50);
+  draw();
+  pio_display_copy(copied, tile);
+  pio_display_update_and_flip();
+  pio_display_wait_for_finish_blocking();
+  bool ok = true;
+  for(uint8_t y = 0; y < DISPLAY_HEIGHT; y++) {
+    for(uint8_t x = 0; x < DISPLAY_WIDTH; x++) {
+      ok = ok && pixel(copied, x, y) == (x >= 10 && x <= 100 && y >= 10 && y <= 50);
+    }
+  }
+  for(uint16_t i = 0; i < displays; i++) {
+    ok = ok && (i == copied || verify(i) == 0);
+  }
+  for(uint8_t i = 0; i < 2; i++) {
+    send_frame();
+    ok = ok && verify(copied) == 0;
+  }
+  printf("copy: %s\n", ok ? "ok" : "FAIL");
+  return ok;
+}
+
+int main(int argc, char **argv) {
+  const char *pio_path = SPI_PIO_PATH;
+  const char *directory = NULL;
+  uint8_t cs = DEFAULT_CS;
+  uint8_t reset = DEFAULT_RESET;
+  displays = DEFAULT_DISPLAYS;
+  chains_size = 1;
+  int opt;
+  while((opt = getopt(argc, argv, "p:n:k:c:r:o:h")) != -1) {
+    switch(opt) {
+    case 'p':
+      pio_path = optarg;
+      break;
+    case 'n':
+      displays = atoi(optarg);
+      break;
+    case 'k':
+      chains_size = atoi(optarg);
+      break;
+    case 'c':
+      cs = atoi(optarg);
+      break;
+    case 'r':
+      reset = atoi(optarg);
+      break;
+    case 'o':
+      directory = optarg;
+      break;
+    default:
+      usage(argv[0]);
+      return 1;
+    }
+  }
+  if(chains_size == 0 || chains_size > PIO_DISPLAY_MAX_CHAINS) {
+    fprintf(stderr, "chains must be 1-%d\n", PIO_DISPLAY_MAX_CHAINS);
+    return 1;
+  }
+  if(displays < chains_size || displays > PIO_DISPLAY_MAX_DISPLAYS) {
+    fprintf(stderr, "displays must be %d-%d\n", chains_size, PIO_DISPLAY_MAX_DISPLAYS);
+    return 1;
+  }
+
+  if(!pio_sim_assemble(pio_path, "spi", &program)) {
+    return 1;
+  }
+
+  // Split the displays evenly, each chain gets its own group of pins
+  pio_display_chain_t topology[PIO_DISPLAY_MAX_CHAINS];
+  for(uint8_t i = 0; i < chains_size; i++) {
+    topology[i].sclk = i * 4;
+    topology[i].mosi = i * 4 + 1;
+    topology[i].dc = i * 4 + 2;
+    topology[i].displays = displays / chains_size + (i < displays % chains_size ? 1 : 0);
+    display_chain_init(&chains[i], topology[i].displays);
+    // The driver addresses column 2 onwards of the 132 column controller RAM
+    chains[i].column_offset = 2;
+  }
+  fake_sdk_init(&program, chains, chains_size, cs, reset);
+
+  if(chains_size == 1) {
+    pio_display_init(displays);
+  } else {
+    pio_display_init_chains(topology, chains_size);
+  }
+  // Wait out the power on delay so that only the frame is timed
+  while(!pio_display_can_wait_without_blocking()) {
+    sleep_ms(1);
+  }
+  const uint64_t init_ns = fake_sdk_time_ns();
+
+  draw();
+  for(uint8_t i = 0; i < chains_size; i++) {
+    display_chain_reset_statistics(&chains[i]);
+  }
+  pio_display_update_and_flip();
+  pio_display_wait_for_finish_blocking();
+  const uint64_t frame_ns = fake_sdk_time_ns() - init_ns;
+  const pio_sim_t * const sm = fake_sdk_state_machine(0, 0);
+
+  printf("init:  %.1f ms\n", init_ns / 1e6);
+  printf("frame: %.1f us over %u chain(s) at clkdiv %u (%.1f frames/s)\n", frame_ns / 1e3, chains_size, sm->clkdiv, 1e9 / frame_ns);
+
+  uint32_t failed = 0;
+  for(uint16_t i = 0; i < displays; i++) {
+    const display_controller_t * const c = controller(i);
+    const uint32_t mismatches = verify(i);
+    const bool ok = mismatches == 0
+      && c->on
+      && c->unknown_commands == 0
+      && c->command_bytes == DISPLAY_PAGES * COMMAND_BYTES_PER_PAGE
+      && c->data_bytes == DISPLAY_PAGES * DISPLAY_WIDTH;
+    if(!ok) {
+      failed++;
+    }
+    printf("display %2u: %s commands=%u data=%u unknown=%u mismatched pixels=%u%s\n",
+           i, ok ? "ok  " : "FAIL",
+           c->command_bytes, c->data_bytes, c->unknown_commands,
+           mismatches, c->on ? "" : " (off)");
+    if(directory != NULL && !write_pbm(directory, i)) {
+      return 1;
+    }
+  }
+  printf("%u of %u displays decoded correctly\n", displays - failed, displays);
+  if(!check_commands()) {
+    failed++;
+  }
+  if(!check_copy()) {
+    failed++;
+  }
+  return failed == 0 ? 0 : 1;
+}
@@ -0,0 +1,342 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdarg.h>
+#include <string.h>
+#include "pico/stdlib.h"
+#include "hardware/pio.h"
+#include "hardware/dma.h"
+#include "fake_sdk.h"
+
+#define PIOS 2
+#define DMA_CHANNELS 12
+
+static pio_hw_t pio_hw[PIOS];
+PIO pio0 = &pio_hw[0];
+PIO pio1 = &pio_hw[1];
+
+typedef struct {
+  dma_channel_config config;
+  uint32_t transfer_count;
+} fake_dma_channel_t;
+
+static const pio_sim_program_t *sim_program;
+static display_chain_t *sim_chains;
+static uint8_t sim_chains_size;
+static uint8_t sim_chains_attached;
+static uint8_t sim_cs_pin;
+static uint8_t sim_reset_pin;
+static pio_sim_t state_machines[PIOS][NUM_PIO_STATE_MACHINES];
+static bool state_machines_claimed[PIOS][NUM_PIO_STATE_MACHINES];
+static fake_dma_channel_t dma_channels[DMA_CHANNELS];
+static dma_channel_hw_t dma_channels_hw[DMA_CHANNELS];
+static uint8_t dma_channels_claimed;
+static uint64_t time_ns;
+
+void fake_sdk_init(const pio_sim_program_t * const program, display_chain_t * const chains, const uint8_t chains_size, const uint8_t cs_pin, const uint8_t reset_pin) {
+  sim_program = program;
+  sim_chains = chains;
+  sim_chains_size = chains_size;
+  sim_chains_attached = 0;
+  sim_cs_pin = cs_pin;
+  sim_reset_pin = reset_pin;
+  memset(state_machines_claimed, 0, sizeof(state_machines_claimed));
+  dma_channels_claimed = 0;
+  time_ns = 0;
+}
+
+pio_sim_t *fake_sdk_state_machine(const uint8_t pio, const uint8_t sm) {
+  return &state_machines[pio][sm];
+}
+
+uint64_t fake_sdk_time_ns() {
+  return time_ns;
+}
+
+static uint8_t pio_index(PIO pio) {
+  return pio == pio0 ? 0 : 1;
+}
+
+void gpio_init(const uint gpio) {
+}
+
+void gpio_set_dir(const uint gpio, const bool out) {
+}
+
+void gpio_put(const uint gpio, const bool value) {
+  for(uint8_t i = 0; i < sim_chains_size; i++) {
+    if(gpio == sim_cs_pin) {
+      display_chain_set_cs(&sim_chains[i], value);
+    } else if(gpio == sim_reset_pin && !value) {
+      display_chain_reset(&sim_chains[i]);
+    }
+  }
+}
+
+void sleep_ms(const uint32_t ms) {
+  time_ns += (uint64_t)ms * 1000000;
+}
+
+void sleep_us(const uint64_t us) {
+  time_ns += us * 1000;
+}
+
+void busy_wait_us_32(const uint32_t us) {
+  time_ns += (uint64_t)us * 1000;
+}
+
+uint32_t time_us_32() {
+  return (uint32_t)(time_ns / 1000);
+}
+
+void panic(const char * const fmt, ...) {
+  va_list args;
+  va_start(args, fmt);
+  vfprintf(stderr, fmt, args);
+  va_end(args);
+  fprintf(stderr, "\n");
+  exit(2);
+}
+
+uint pio_add_program(PIO pio, const pio_program_t * const program) {
+  return 0;
+}
+
+int pio_claim_unused_sm(PIO pio, const bool required) {
+  for(uint8_t i = 0; i < NUM_PIO_STATE_MACHINES; i++) {
+    if(!state_machines_claimed[pio_index(pio)][i]) {
+      state_machines_claimed[pio_index(pio)][i] = true;
+      return i;
+    }
+  }
+  if(required) {
+    panic("No PIO state machine available");
+  }
+  return -1;
+}
+
+uint pio_get_dreq(PIO pio, const uint sm, const bool is_tx) {
+  return pio_index(pio) * 8 + sm;
+}
+
+void pio_gpio_init(PIO pio, const uint pin) {
+}
+
+void pio_sm_set_consecutive_pindirs(PIO pio, const uint sm, const uint pin, const uint count, const bool is_out) {
+}
+
+void pio_sm_init(PIO pio, const uint sm, const uint initial_pc, const pio_sm_config * const config) {
+  if(sim_chains_attached == sim_chains_size) {
+    panic("More state machines initialized than simulated display chains");
+  }
+  display_chain_t * const chain = &sim_chains[sim_chains_attached++];
+  pio_sim_t * const state_machine = &state_machines[pio_index(pio)][sm];
+  pio_sim_init(state_machine, sim_program);
+  state_machine->out_base = config->out_base;
+  state_machine->set_base = config->set_base;
+  state_machine->set_count = config->set_count;
+  state_machine->sideset_base = config->sideset_base;
+  state_machine->clkdiv = 1;
+  state_machine->pins_changed = display_chain_pins_changed;
+  state_machine->context = chain;
+  chain->mosi_pin = config->out_base;
+  chain->dc_pin = config->set_base;
+  chain->shift_cs_pin = config->set_base + 1;
+  chain->sclk_pin = config->sideset_base;
+  if(config->out_shift_right || !config->autopull || config->pull_threshold != 32) {
+    panic("Simulator only models left shifting autopull at 32 bits");
+  }
+}
+
+void pio_sm_set_clkdiv_int_frac(PIO pio, const uint sm, const uint16_t div_int, const uint8_t div_frac) {
+  state_machines[pio_index(pio)][sm].clkdiv = div_int;
+}
+
+void pio_sm_set_enabled(PIO pio, const uint sm, const bool enabled) {
+}
+
+int dma_claim_unused_channel(const bool required) {
+  if(dma_channels_claimed == DMA_CHANNELS) {
+    if(required) {
+      panic("No DMA channel available");
+    }
+    return -1;
+  }
+  return dma_channels_claimed++;
+}
+
+dma_channel_config dma_channel_get_default_config(const uint channel) {
+  const dma_channel_config config = {
+    .dreq = 0,
+    .size = DMA_SIZE_32,
+    .bswap = false,
+    .read_increment = true,
+    .write_increment = false,
+    .chain_to = channel
+  };
+  return config;
+}
+
+dma_channel_hw_t *dma_channel_hw_addr(const uint channel) {
+  return &dma_channels_hw[channel];
+}
+
+void dma_channel_configure(const uint channel, const dma_channel_config * const config,
+                           volatile void *write_addr, const volatile void *read_addr,
+                           const uint transfer_count, const bool trigger) {
+  dma_channels[channel].config = *config;
+  dma_channels_hw[channel].write_addr = (uintptr_t)write_addr;
+  dma_channels_hw[channel].read_addr = (uintptr_t)read_addr;
+  dma_channels[channel].transfer_count = transfer_count;
+  if(trigger) {
+    dma_start_channel_mask(1u << channel);
+  }
+}
+
+void dma_channel_set_config(const uint channel, const dma_channel_config * const config, const bool trigger) {
+  dma_channels[channel].config = *config;
+  if(trigger) {
+    dma_start_channel_mask(1u << channel);
+  }
+}
+
+static uint32_t bswap(const uint32_t word) {
+  return (word >> 24) | ((word >> 8) & 0xFF00) | ((word << 8) & 0xFF0000) | (word << 24);
+}
+
+static pio_sim_t *dma_state_machine(const uint channel) {
+  for(uint8_t i = 0; i < PIOS; i++) {
+    for(uint8_t j = 0; j < NUM_PIO_STATE_MACHINES; j++) {
+      if(dma_channels_hw[channel].write_addr == (uintptr_t)&pio_hw[i].txf[j]) {
+        return &state_machines[i][j];
+      }
+    }
+  }
+  return NULL;
+}
+
+// The channel whose write address trigger a control channel writes to
+static int dma_triggered_channel(const uint channel) {
+  for(uint8_t i = 0; i < DMA_CHANNELS; i++) {
+    if(dma_channels_hw[channel].write_addr == (uintptr_t)&dma_channels_hw[i].al2_write_addr_trig) {
+      return i;
+    }
+  }
+  return -1;
+}
+
+static uint64_t cycles_to_ns(const pio_sim_t * const state_machine, const uint64_t cycles) {
+  return cycles * state_machine->clkdiv * 1000000000ull / FAKE_SDK_SYSTEM_CLOCK;
+}
+
+// Runs one channel to completion: every word is pushed and the state
+// machine is run until it stalls waiting for more data. Returns the
+// wire time of the transfer.
+static uint64_t run_pio_transfer(const uint channel, pio_sim_t * const state_machine) {
+  const fake_dma_channel_t dma = dma_channels[channel];
+  uint64_t ns = 0;
+  const uint8_t *bytes = (const uint8_t *)dma_channels_hw[channel].read_addr;
+  for(uint32_t i = 0; i < dma.transfer_count; i++) {
+    uint32_t word;
+    memcpy(&word, bytes + i * 4, 4);
+    if(dma.config.bswap) {
+      word = bswap(word);
+    }
+    if(!pio_sim_push(state_machine, word)) {
+      ns += cycles_to_ns(state_machine, pio_sim_run(state_machine));
+      pio_sim_push(state_machine, word);
+    }
+  }
+  return ns + cycles_to_ns(state_machine, pio_sim_run(state_machine));
+}
+
+static uint64_t run_transfer(const uint channel);
+
+// Memory to memory transfers take no wire time. A control channel writes
+// each entry to the trigger of another channel, which runs at once, and
+// a NULL entry triggers nothing.
+static uint64_t run_memory_transfer(const uint channel) {
+  const fake_dma_channel_t dma = dma_channels[channel];
+  dma_channel_hw_t * const hw = &dma_channels_hw[channel];
+  const int triggered = dma_triggered_channel(channel);
+  const uint32_t size = triggered >= 0 ? sizeof(uintptr_t) : 4;
+  uint64_t ns = 0;
+  for(uint32_t i = 0; i < dma.transfer_count; i++) {
+    if(triggered >= 0) {
+      uintptr_t entry;
+      memcpy(&entry, (const void *)hw->read_addr, size);
+      if(dma.config.read_increment) {
+        hw->read_addr += size;
+      }
+      if(entry != 0) {
+        dma_channels_hw[triggered].write_addr = entry;
+        ns += run_transfer(triggered);
+      }
+      continue;
+    }
+    memcpy((void *)hw->write_addr, (const void *)hw->read_addr, size);
+    if(dma.config.read_increment) {
+      hw->read_addr += size;
+    }
+    if(dma.config.write_increment) {
+      hw->write_addr += size;
+    }
+  }
+  return ns;
+}
+
+static uint64_t run_transfer(const uint channel) {
+  const fake_dma_channel_t dma = dma_channels[channel];
+  if(dma.config.size != DMA_SIZE_32) {
+    panic("Simulator only models 32 bit DMA transfers");
+  }
+  pio_sim_t * const state_machine = dma_state_machine(channel);
+  uint64_t ns = state_machine != NULL ? run_pio_transfer(channel, state_machine) : run_memory_transfer(channel);
+  if(dma.config.chain_to != channel) {
+    ns += run_transfer(dma.config.chain_to);
+  }
+  return ns;
+}
+
+void dma_channel_set_read_addr(const uint channel, const volatile void *read_addr, const bool trigger) {
+  dma_channels_hw[channel].read_addr = (uintptr_t)read_addr;
+  if(trigger) {
+    dma_start_channel_mask(1u << channel);
+  }
+}
+
+void dma_channel_set_trans_count(const uint channel, const uint32_t transfer_count, const bool trigger) {
+  dma_channels[channel].transfer_count = transfer_count;
+  if(trigger) {
+    dma_start_channel_mask(1u << channel);
+  }
+}
+
+// Channels started together run concurrently, so time advances by the
+// longest transfer
+void dma_start_channel_mask(const uint32_t channels_mask) {
+  uint64_t longest = 0;
+  for(uint8_t i = 0; i < DMA_CHANNELS; i++) {
+    if(channels_mask & (1u << i)) {
+      const uint64_t ns = run_transfer(i);
+      longest = MAX(longest, ns);
+    }
+  }
+  time_ns += longest;
+}
+
+void dma_channel_start(const uint channel) {
+  dma_start_channel_mask(1u << channel);
+}
+
+void dma_channel_transfer_from_buffer_now(const uint channel, const volatile void *read_addr, const uint32_t transfer_count) {
+  dma_channels_hw[channel].read_addr = (uintptr_t)read_addr;
+  dma_channels[channel].transfer_count = transfer_count;
+  dma_start_channel_mask(1u << channel);
+}
+
+void dma_channel_wait_for_finish_blocking(const uint channel) {
+}
+
+bool dma_channel_is_busy(const uint channel) {
+  return false;
+}
@@ -0,0 +1,12 @@
+#pragma once
+#include "pio_sim.h"
+#include "display_chain.h"
+
+#define FAKE_SDK_SYSTEM_CLOCK 125000000
+
+// Wires the fake SDK used by the host build of pio_display to a PIO
+// program simulator and display chains. Chains are attached to state
+// machines in the order the driver initializes them.
+void fake_sdk_init(const pio_sim_program_t * const program, display_chain_t * const chains, const uint8_t chains_size, const uint8_t cs_pin, const uint8_t reset_pin);
+pio_sim_t *fake_sdk_state_machine(const uint8_t pio, const uint8_t sm);
+uint64_t fake_sdk_time_ns();
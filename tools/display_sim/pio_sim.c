@@ -0,0 +1,344 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include "pio_sim.h"
+
+// Assembler for the subset of pioasm used by the display programs:
+// out, jmp, set, .side_set, .wrap_target and .wrap. Unsupported syntax
+// is reported so the simulator never silently diverges from the source.
+
+typedef struct {
+  char name[32];
+  uint8_t address;
+} label_t;
+
+typedef struct {
+  char target[32];
+  uint8_t address;
+} fixup_t;
+
+static char *trim(char *s) {
+  while(isspace((unsigned char)*s)) {
+    s++;
+  }
+  char *end = s + strlen(s);
+  while(end > s && isspace((unsigned char)end[-1])) {
+    *--end = '\0';
+  }
+  return s;
+}
+
+static bool parse_number(const char * const s, uint32_t * const value) {
+  char *end;
+  if(strncmp(s, "0b", 2) == 0) {
+    *value = strtoul(s + 2, &end, 2);
+  } else {
+    *value = strtoul(s, &end, 0);
+  }
+  return end != s && *trim(end) == '\0';
+}
+
+static bool parse_destination(const char * const s, pio_sim_destination_t * const destination) {
+  if(strcmp(s, "pins") == 0) {
+    *destination = PIO_SIM_DEST_PINS;
+  } else if(strcmp(s, "X") == 0 || strcmp(s, "x") == 0) {
+    *destination = PIO_SIM_DEST_X;
+  } else if(strcmp(s, "Y") == 0 || strcmp(s, "y") == 0) {
+    *destination = PIO_SIM_DEST_Y;
+  } else if(strcmp(s, "null") == 0) {
+    *destination = PIO_SIM_DEST_NULL;
+  } else {
+    return false;
+  }
+  return true;
+}
+
+static bool parse_condition(const char * const s, pio_sim_condition_t * const condition) {
+  if(strcmp(s, "!X") == 0 || strcmp(s, "!x") == 0) {
+    *condition = PIO_SIM_NOT_X;
+  } else if(strcmp(s, "X--") == 0 || strcmp(s, "x--") == 0) {
+    *condition = PIO_SIM_X_DEC;
+  } else if(strcmp(s, "!Y") == 0 || strcmp(s, "!y") == 0) {
+    *condition = PIO_SIM_NOT_Y;
+  } else if(strcmp(s, "Y--") == 0 || strcmp(s, "y--") == 0) {
+    *condition = PIO_SIM_Y_DEC;
+  } else {
+    return false;
+  }
+  return true;
+}
+
+static bool parse_instruction(char * const line, pio_sim_instruction_t * const instruction, fixup_t * const fixup) {
+  uint32_t sideset = 0;
+  char *side = strstr(line, "sideset");
+  if(side == NULL) {
+    side = strstr(line, "side");
+  }
+  if(side != NULL) {
+    char *value = side + (strncmp(side, "sideset", 7) == 0 ? 7 : 4);
+    if(!parse_number(trim(value), &sideset)) {
+      return false;
+    }
+    *side = '\0';
+  }
+  instruction->sideset = sideset;
+
+  char *operands = trim(line);
+  char *mnemonic = strsep(&operands, " \t");
+  operands = operands == NULL ? "" : trim(operands);
+
+  if(strcmp(mnemonic, "out") == 0) {
+    char *destination = trim(strsep(&operands, ","));
+    uint32_t bits;
+    if(operands == NULL || !parse_destination(destination, &instruction->destination) || !parse_number(trim(operands), &bits) || bits == 0 || bits > 32) {
+      return false;
+    }
+    instruction->opcode = PIO_SIM_OUT;
+    instruction->value = bits;
+  } else if(strcmp(mnemonic, "set") == 0) {
+    char *destination = strsep(&operands, " \t,");
+    uint32_t value;
+    if(operands == NULL || strcmp(destination, "pins") != 0 || !parse_number(trim(operands), &value) || value > 31) {
+      return false;
+    }
+    instruction->opcode = PIO_SIM_SET;
+    instruction->destination = PIO_SIM_DEST_PINS;
+    instruction->value = value;
+  } else if(strcmp(mnemonic, "jmp") == 0) {
+    char *first = strsep(&operands, " \t,");
+    instruction->opcode = PIO_SIM_JMP;
+    if(operands != NULL && *trim(operands) != '\0') {
+      if(!parse_condition(first, &instruction->condition)) {
+        return false;
+      }
+      strncpy(fixup->target, trim(operands), sizeof(fixup->target) - 1);
+    } else {
+      instruction->condition = PIO_SIM_ALWAYS;
+      strncpy(fixup->target, first, sizeof(fixup->target) - 1);
+    }
+  } else {
+    return false;
+  }
+  return true;
+}
+
+bool pio_sim_assemble(const char * const path, const char * const name, pio_sim_program_t * const program) {
+  FILE *f = fopen(path, "r");
+  if(f == NULL) {
+    fprintf(stderr, "%s: cannot open\n", path);
+    return false;
+  }
+
+  label_t labels[PIO_SIM_MAX_LABELS];
+  uint8_t labels_size = 0;
+  fixup_t fixups[PIO_SIM_MAX_INSTRUCTIONS];
+  memset(fixups, 0, sizeof(fixups));
+  memset(program, 0, sizeof(*program));
+
+  bool in_program = false;
+  bool wrap_set = false;
+  bool ok = true;
+  char buffer[256];
+  uint32_t line_number = 0;
+  while(ok && fgets(buffer, sizeof(buffer), f) != NULL) {
+    line_number++;
+    char *comment = strchr(buffer, ';');
+    if(comment != NULL) {
+      *comment = '\0';
+    }
+    char *line = trim(buffer);
+    if(*line == '\0') {
+      continue;
+    }
+    if(line[0] == '%') {
+      // The c-sdk block ends the program
+      if(in_program) {
+        break;
+      }
+      continue;
+    }
+    if(strncmp(line, ".program", 8) == 0) {
+      if(in_program) {
+        break;
+      }
+      in_program = strcmp(trim(line + 8), name) == 0;
+      continue;
+    }
+    if(!in_program) {
+      continue;
+    }
+    if(strcmp(line, ".wrap_target") == 0) {
+      program->wrap_target = program->length;
+    } else if(strcmp(line, ".wrap") == 0) {
+      program->wrap = program->length - 1;
+      wrap_set = true;
+    } else if(strncmp(line, ".side_set", 9) == 0) {
+      uint32_t bits;
+      if(!parse_number(trim(line + 9), &bits) || bits != 1) {
+        ok = false;
+      }
+    } else if(line[strlen(line) - 1] == ':') {
+      line[strlen(line) - 1] = '\0';
+      if(labels_size == PIO_SIM_MAX_LABELS) {
+        ok = false;
+      } else {
+        strncpy(labels[labels_size].name, trim(line), sizeof(labels[labels_size].name) - 1);
+        labels[labels_size].name[sizeof(labels[labels_size].name) - 1] = '\0';
+        labels[labels_size].address = program->length;
+        labels_size++;
+      }
+    } else if(program->length == PIO_SIM_MAX_INSTRUCTIONS) {
+      ok = false;
+    } else {
+      ok = parse_instruction(line, &program->instructions[program->length], &fixups[program->length]);
+      program->length++;
+    }
+    if(!ok) {
+      fprintf(stderr, "%s:%u: unsupported PIO syntax\n", path, line_number);
+    }
+  }
+  fclose(f);
+
+  if(ok && program->length == 0) {
+    fprintf(stderr, "%s: program %s not found\n", path, name);
+    ok = false;
+  }
+  if(ok && !wrap_set) {
+    program->wrap = program->length - 1;
+  }
+
+  for(uint8_t i = 0; ok && i < program->length; i++) {
+    if(program->instructions[i].opcode != PIO_SIM_JMP) {
+      continue;
+    }
+    bool found = false;
+    for(uint8_t j = 0; j < labels_size; j++) {
+      if(strcmp(labels[j].name, fixups[i].target) == 0) {
+        program->instructions[i].value = labels[j].address;
+        found = true;
+      }
+    }
+    if(!found) {
+      fprintf(stderr, "%s: unknown label %s\n", path, fixups[i].target);
+      ok = false;
+    }
+  }
+  return ok;
+}
+
+void pio_sim_init(pio_sim_t * const sm, const pio_sim_program_t * const program) {
+  sm->program = program;
+  sm->pc = 0;
+  sm->x = 0;
+  sm->y = 0;
+  sm->osr = 0;
+  sm->osr_count = 32;
+  sm->fifo_read = 0;
+  sm->fifo_write = 0;
+  sm->pins = 0;
+  sm->cycles = 0;
+}
+
+bool pio_sim_push(pio_sim_t * const sm, const uint32_t word) {
+  if(sm->fifo_write - sm->fifo_read == PIO_SIM_FIFO_SIZE) {
+    return false;
+  }
+  sm->fifo[sm->fifo_write % PIO_SIM_FIFO_SIZE] = word;
+  sm->fifo_write++;
+  return true;
+}
+
+static void set_pin(pio_sim_t * const sm, const uint8_t pin, const uint32_t value) {
+  sm->pins = (sm->pins & ~(1u << pin)) | ((value & 1) << pin);
+}
+
+// OUT with autopull, shifting left (MSB first) with a threshold of 32
+static bool out(pio_sim_t * const sm, const uint8_t bits, uint32_t * const value) {
+  if(sm->osr_count == 32) {
+    if(sm->fifo_read == sm->fifo_write) {
+      return false;
+    }
+    sm->osr = sm->fifo[sm->fifo_read % PIO_SIM_FIFO_SIZE];
+    sm->fifo_read++;
+    sm->osr_count = 0;
+  }
+  *value = bits == 32 ? sm->osr : sm->osr >> (32 - bits);
+  sm->osr = bits == 32 ? 0 : sm->osr << bits;
+  sm->osr_count = sm->osr_count + bits > 32 ? 32 : sm->osr_count + bits;
+  return true;
+}
+
+// Runs until the state machine stalls on an empty FIFO, returns the number of cycles executed
+uint64_t pio_sim_run(pio_sim_t * const sm) {
+  const uint64_t start = sm->cycles;
+  for(;;) {
+    const pio_sim_instruction_t instruction = sm->program->instructions[sm->pc];
+    const uint32_t pins = sm->pins;
+    uint8_t next = sm->pc == sm->program->wrap ? sm->program->wrap_target : sm->pc + 1;
+
+    switch(instruction.opcode) {
+    case PIO_SIM_OUT: {
+      uint32_t value;
+      if(!out(sm, instruction.value, &value)) {
+        return sm->cycles - start;
+      }
+      switch(instruction.destination) {
+      case PIO_SIM_DEST_PINS:
+        for(uint8_t i = 0; i < instruction.value; i++) {
+          set_pin(sm, sm->out_base + i, value >> i);
+        }
+        break;
+      case PIO_SIM_DEST_X:
+        sm->x = value;
+        break;
+      case PIO_SIM_DEST_Y:
+        sm->y = value;
+        break;
+      case PIO_SIM_DEST_NULL:
+        break;
+      }
+      break;
+    }
+    case PIO_SIM_SET:
+      for(uint8_t i = 0; i < sm->set_count; i++) {
+        set_pin(sm, sm->set_base + i, instruction.value >> i);
+      }
+      break;
+    case PIO_SIM_JMP: {
+      bool jump = false;
+      switch(instruction.condition) {
+      case PIO_SIM_ALWAYS:
+        jump = true;
+        break;
+      case PIO_SIM_NOT_X:
+        jump = sm->x == 0;
+        break;
+      case PIO_SIM_X_DEC:
+        jump = sm->x != 0;
+        sm->x--;
+        break;
+      case PIO_SIM_NOT_Y:
+        jump = sm->y == 0;
+        break;
+      case PIO_SIM_Y_DEC:
+        jump = sm->y != 0;
+        sm->y--;
+        break;
+      }
+      if(jump) {
+        next = instruction.value;
+      }
+      break;
+    }
+    }
+
+    // Data and set pins settle in the same cycle as the side-set pin
+    set_pin(sm, sm->sideset_base, instruction.sideset);
+    if(sm->pins != pins && sm->pins_changed != NULL) {
+      sm->pins_changed(sm->context, sm->pins);
+    }
+    sm->pc = next;
+    sm->cycles++;
+  }
+}
@@ -0,0 +1,71 @@
+#pragma once
+#include <stdint.h>
+#include <stdbool.h>
+
+#define PIO_SIM_MAX_INSTRUCTIONS 32
+#define PIO_SIM_MAX_LABELS 32
+#define PIO_SIM_FIFO_SIZE (1 << 16)
+
+typedef enum {
+  PIO_SIM_OUT,
+  PIO_SIM_JMP,
+  PIO_SIM_SET
+} pio_sim_opcode_t;
+
+typedef enum {
+  PIO_SIM_DEST_PINS,
+  PIO_SIM_DEST_X,
+  PIO_SIM_DEST_Y,
+  PIO_SIM_DEST_NULL
+} pio_sim_destination_t;
+
+typedef enum {
+  PIO_SIM_ALWAYS,
+  PIO_SIM_NOT_X,
+  PIO_SIM_X_DEC,
+  PIO_SIM_NOT_Y,
+  PIO_SIM_Y_DEC
+} pio_sim_condition_t;
+
+typedef struct {
+  pio_sim_opcode_t opcode;
+  pio_sim_destination_t destination;
+  pio_sim_condition_t condition;
+  uint8_t value;
+  uint8_t sideset;
+} pio_sim_instruction_t;
+
+typedef struct {
+  pio_sim_instruction_t instructions[PIO_SIM_MAX_INSTRUCTIONS];
+  uint8_t length;
+  uint8_t wrap_target;
+  uint8_t wrap;
+} pio_sim_program_t;
+
+typedef void (*pio_sim_pins_callback_t)(void * const context, const uint32_t pins);
+
+typedef struct {
+  const pio_sim_program_t *program;
+  uint8_t pc;
+  uint32_t x;
+  uint32_t y;
+  uint32_t osr;
+  uint8_t osr_count;
+  uint32_t fifo[PIO_SIM_FIFO_SIZE];
+  uint32_t fifo_read;
+  uint32_t fifo_write;
+  uint8_t out_base;
+  uint8_t set_base;
+  uint8_t set_count;
+  uint8_t sideset_base;
+  uint16_t clkdiv;
+  uint32_t pins;
+  uint64_t cycles;
+  pio_sim_pins_callback_t pins_changed;
+  void *context;
+} pio_sim_t;
+
+bool pio_sim_assemble(const char * const path, const char * const name, pio_sim_program_t * const program);
+void pio_sim_init(pio_sim_t * const sm, const pio_sim_program_t * const program);
+bool pio_sim_push(pio_sim_t * const sm, const uint32_t word);
+uint64_t pio_sim_run(pio_sim_t * const sm);
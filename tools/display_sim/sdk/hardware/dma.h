@@ -0,0 +1,66 @@
+#pragma once
+#include "pico/stdlib.h"
+
+enum dma_channel_transfer_size {
+  DMA_SIZE_8 = 0,
+  DMA_SIZE_16 = 1,
+  DMA_SIZE_32 = 2
+};
+
+typedef struct {
+  uint dreq;
+  enum dma_channel_transfer_size size;
+  bool bswap;
+  bool read_increment;
+  bool write_increment;
+  uint chain_to;
+} dma_channel_config;
+
+// Only the registers the driver reads or that a channel writes to. The
+// addresses are host pointers, a control channel moves pointer sized
+// entries.
+typedef struct {
+  volatile uintptr_t read_addr;
+  volatile uintptr_t write_addr;
+  volatile uintptr_t al2_write_addr_trig;
+} dma_channel_hw_t;
+
+dma_channel_hw_t *dma_channel_hw_addr(const uint channel);
+
+int dma_claim_unused_channel(const bool required);
+dma_channel_config dma_channel_get_default_config(const uint channel);
+void dma_channel_configure(const uint channel, const dma_channel_config * const config,
+                           volatile void *write_addr, const volatile void *read_addr,
+                           const uint transfer_count, const bool trigger);
+void dma_channel_transfer_from_buffer_now(const uint channel, const volatile void *read_addr, const uint32_t transfer_count);
+void dma_channel_set_config(const uint channel, const dma_channel_config * const config, const bool trigger);
+void dma_channel_start(const uint channel);
+void dma_channel_set_read_addr(const uint channel, const volatile void *read_addr, const bool trigger);
+void dma_channel_set_trans_count(const uint channel, const uint32_t transfer_count, const bool trigger);
+void dma_start_channel_mask(const uint32_t channels_mask);
+void dma_channel_wait_for_finish_blocking(const uint channel);
+bool dma_channel_is_busy(const uint channel);
+
+static inline void channel_config_set_dreq(dma_channel_config *c, uint dreq) {
+  c->dreq = dreq;
+}
+
+static inline void channel_config_set_transfer_data_size(dma_channel_config *c, enum dma_channel_transfer_size size) {
+  c->size = size;
+}
+
+static inline void channel_config_set_bswap(dma_channel_config *c, bool bswap) {
+  c->bswap = bswap;
+}
+
+static inline void channel_config_set_read_increment(dma_channel_config *c, bool increment) {
+  c->read_increment = increment;
+}
+
+static inline void channel_config_set_write_increment(dma_channel_config *c, bool increment) {
+  c->write_increment = increment;
+}
+
+static inline void channel_config_set_chain_to(dma_channel_config *c, uint chain_to) {
+  c->chain_to = chain_to;
+}
@@ -0,0 +1,60 @@
+#pragma once
+#include "pico/stdlib.h"
+
+#define NUM_PIO_STATE_MACHINES 4
+
+typedef struct {
+  volatile uint32_t txf[NUM_PIO_STATE_MACHINES];
+} pio_hw_t;
+
+typedef pio_hw_t *PIO;
+
+extern PIO pio0;
+extern PIO pio1;
+
+typedef struct {
+  uint origin;
+  uint out_base;
+  uint out_count;
+  uint set_base;
+  uint set_count;
+  uint sideset_base;
+  bool out_shift_right;
+  bool autopull;
+  uint pull_threshold;
+} pio_sm_config;
+
+typedef struct {
+  const uint16_t *instructions;
+  uint8_t length;
+  int8_t origin;
+} pio_program_t;
+
+uint pio_add_program(PIO pio, const pio_program_t * const program);
+int pio_claim_unused_sm(PIO pio, const bool required);
+uint pio_get_dreq(PIO pio, const uint sm, const bool is_tx);
+void pio_gpio_init(PIO pio, const uint pin);
+void pio_sm_set_consecutive_pindirs(PIO pio, const uint sm, const uint pin, const uint count, const bool is_out);
+void pio_sm_init(PIO pio, const uint sm, const uint initial_pc, const pio_sm_config * const config);
+void pio_sm_set_clkdiv_int_frac(PIO pio, const uint sm, const uint16_t div_int, const uint8_t div_frac);
+void pio_sm_set_enabled(PIO pio, const uint sm, const bool enabled);
+
+static inline void sm_config_set_out_pins(pio_sm_config *c, uint base, uint count) {
+  c->out_base = base;
+  c->out_count = count;
+}
+
+static inline void sm_config_set_set_pins(pio_sm_config *c, uint base, uint count) {
+  c->set_base = base;
+  c->set_count = count;
+}
+
+static inline void sm_config_set_sideset_pins(pio_sm_config *c, uint base) {
+  c->sideset_base = base;
+}
+
+static inline void sm_config_set_out_shift(pio_sm_config *c, bool shift_right, bool autopull, uint threshold) {
+  c->out_shift_right = shift_right;
+  c->autopull = autopull;
+  c->pull_threshold = threshold;
+}
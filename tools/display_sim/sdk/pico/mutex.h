@@ -0,0 +1,17 @@
+#pragma once
+#include "pico/stdlib.h"
+
+// The simulation runs on one thread
+typedef struct {
+  bool owned;
+} mutex_t;
+
+#define auto_init_mutex(name) static mutex_t name
+
+static inline void mutex_enter_blocking(mutex_t *mutex) {
+  mutex->owned = true;
+}
+
+static inline void mutex_exit(mutex_t *mutex) {
+  mutex->owned = false;
+}
@@ -0,0 +1,28 @@
+#pragma once
+// Minimal host stand-in for the parts of the Pico SDK used by pio_display
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+typedef unsigned int uint;
+
+#ifndef MIN
+#define MIN(a, b) ((a) < (b) ? (a) : (b))
+#endif
+#ifndef MAX
+#define MAX(a, b) ((a) > (b) ? (a) : (b))
+#endif
+
+#define GPIO_OUT 1
+#define GPIO_IN 0
+
+void gpio_init(const uint gpio);
+void gpio_set_dir(const uint gpio, const bool out);
+void gpio_put(const uint gpio, const bool value);
+
+void sleep_ms(const uint32_t ms);
+void sleep_us(const uint64_t us);
+void busy_wait_us_32(const uint32_t us);
+uint32_t time_us_32();
+void panic(const char * const fmt, ...);
+static inline void tight_loop_contents() {}
@@ -0,0 +1,171 @@
+#!/usr/bin/env python3
+"""Compiles BDF bitmap fonts into the packed glyph tables of pio_display.
+
+Every glyph is stored as columns of display pages, the way the SSD1306
+lays out its RAM: one byte per 8 pixel rows, bit 0 at the bottom of the
+font cell. A glyph starting on a page boundary is drawn by writing its
+bytes, otherwise by shifting each byte across two pages. Each glyph has
+its own advance, so proportional fonts take only the width they need.
+
+    compile_fonts.py -o fonts.inc font_13.bdf font_18.bdf font_28.bdf
+
+The fonts are numbered in the order given, which must match
+pio_display_font_size_t. PCF fonts can be converted with pcf2bdf first.
+The tables carry FONT_SECTION, which the includer can define to place
+them in a section of its choice.
+"""
+
+import argparse
+import os
+import sys
+
+
+class Glyph:
+    def __init__(self):
+        self.encoding = -1
+        self.advance = 0
+        self.width = 0
+        self.height = 0
+        self.x = 0
+        self.y = 0
+        self.rows = []
+
+
+class Font:
+    def __init__(self, name):
+        self.name = name
+        self.ascent = None
+        self.descent = None
+        self.box_height = 0
+        self.box_y = 0
+        self.glyphs = {}
+
+
+def fail(path, line, message):
+    sys.exit('%s:%d: %s' % (path, line, message))
+
+
+def parse(path):
+    name = os.path.splitext(os.path.basename(path))[0]
+    font = Font(name)
+    glyph = None
+    bitmap = False
+    with open(path, encoding='latin-1') as f:
+        for number, line in enumerate(f, 1):
+            words = line.split()
+            if not words:
+                continue
+            keyword = words[0]
+            if bitmap and keyword != 'ENDCHAR':
+                glyph.rows.append(int(keyword, 16))
+            elif keyword == 'FONTBOUNDINGBOX':
+                font.box_height = int(words[2])
+                font.box_y = int(words[4])
+            elif keyword == 'FONT_ASCENT':
+                font.ascent = int(words[1])
+            elif keyword == 'FONT_DESCENT':
+                font.descent = int(words[1])
+            elif keyword == 'STARTCHAR':
+                glyph = Glyph()
+            elif keyword == 'ENCODING':
+                glyph.encoding = int(words[1])
+            elif keyword == 'DWIDTH':
+                glyph.advance = int(words[1])
+            elif keyword == 'BBX':
+                glyph.width, glyph.height, glyph.x, glyph.y = (int(w) for w in words[1:5])
+            elif keyword == 'BITMAP':
+                bitmap = True
+            elif keyword == 'ENDCHAR':
+                bitmap = False
+                if len(glyph.rows) != glyph.height:
+                    fail(path, number, 'glyph %d has %d rows, BBX says %d' % (glyph.encoding, len(glyph.rows), glyph.height))
+                # Encoding -1 marks glyphs without a code, not reachable
+                if 0 <= glyph.encoding < 256:
+                    font.glyphs[glyph.encoding] = glyph
+                glyph = None
+    if font.ascent is None or font.descent is None:
+        font.ascent = font.box_height + font.box_y
+        font.descent = -font.box_y
+    if not font.glyphs:
+        sys.exit('%s: no glyphs with codes 0-255' % path)
+    return font
+
+
+def pack(font, glyph, path):
+    """Columns of page bytes from the left edge of the glyph's advance."""
+    height = font.ascent + font.descent
+    pages = (height + 7) // 8
+    columns = max(glyph.x + glyph.width, 0)
+    if glyph.x < 0:
+        sys.exit('%s: glyph %d starts left of its origin' % (path, glyph.encoding))
+    if columns > 255 or glyph.advance > 255:
+        sys.exit('%s: glyph %d is too wide' % (path, glyph.encoding))
+    packed = [0] * (columns * pages)
+    row_bits = (glyph.width + 7) // 8 * 8
+    for r, bits in enumerate(glyph.rows):
+        # Height above the bottom of the font cell
+        y = glyph.y + glyph.height - 1 - r + font.descent
+        if y < 0 or y >= height:
+            if bits != 0:
+                sys.exit('%s: glyph %d is outside the font cell' % (path, glyph.encoding))
+            continue
+        for c in range(glyph.width):
+            if (bits >> (row_bits - 1 - c)) & 1:
+                packed[(glyph.x + c) * pages + y // 8] |= 1 << (y % 8)
+    return columns, packed
+
+
+def compile_font(font, path, out):
+    height = font.ascent + font.descent
+    pages = (height + 7) // 8
+    first = min(font.glyphs)
+    last = max(font.glyphs)
+    bitmaps = []
+    index = []
+    for code in range(first, last + 1):
+        glyph = font.glyphs.get(code)
+        if glyph is None:
+            index.append((0, 0, 0, code))
+            continue
+        columns, packed = pack(font, glyph, path)
+        index.append((len(bitmaps), columns, glyph.advance, code))
+        bitmaps.extend(packed)
+    if len(bitmaps) > 0xFFFF:
+        sys.exit('%s: too much glyph data' % path)
+
+    out.append('static const uint8_t %s_bitmaps[] FONT_SECTION = {' % font.name)
+    for i in range(0, len(bitmaps), 12):
+        out.append('  ' + ', '.join('0x%02x' % b for b in bitmaps[i:i + 12]) + ',')
+    out.append('};')
+    out.append('')
+    out.append('static const pio_display_glyph_t %s_glyphs[] FONT_SECTION = {' % font.name)
+    for offset, columns, advance, code in index:
+        comment = ' \'%s\'' % chr(code) if 0x20 < code < 0x7F and chr(code) not in '\\\'*/' else ''
+        out.append('  {%d, %d, %d}, /* %d%s */' % (offset, columns, advance, code, comment))
+    out.append('};')
+    out.append('')
+    return '{%s_glyphs, %s_bitmaps, %d, %d, %d, %d}' % (font.name, font.name, height, pages, first, last - first + 1)
+
+
+def main():
+    parser = argparse.ArgumentParser(description='Compile BDF fonts for pio_display')
+    parser.add_argument('-o', '--output', required=True)
+    parser.add_argument('fonts', nargs='+')
+    arguments = parser.parse_args()
+
+    out = ['/* Generated by compile_fonts.py from %s, do not edit */' % ', '.join(os.path.basename(p) for p in arguments.fonts), '',
+           '/* Section attribute of the tables, flash .rodata by default */',
+           '#ifndef FONT_SECTION', '#define FONT_SECTION', '#endif', '']
+    entries = []
+    for path in arguments.fonts:
+        entries.append(compile_font(parse(path), path, out))
+    out.append('static const pio_display_font_t fonts[] FONT_SECTION = {')
+    for entry in entries:
+        out.append('  %s,' % entry)
+    out.append('};')
+    with open(arguments.output, 'w') as f:
+        f.write('\n'.join(out) + '\n')
+
+
+if __name__ == '__main__':
+    main()
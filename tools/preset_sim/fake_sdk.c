@@ -0,0 +1,99 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdarg.h>
+#include <string.h>
+#include "pico/stdlib.h"
+#include "pico/multicore.h"
+#include "hardware/flash.h"
+#include "hardware/sync.h"
+#include "hardware/regs/addressmap.h"
+#include "fake_sdk.h"
+
+uint8_t fake_flash[PICO_FLASH_SIZE_BYTES];
+jmp_buf fake_sdk_power_cut;
+
+// Far more than any test needs, a log that never settles fails instead
+#define MAX_OPERATIONS 100000
+
+static uint32_t operations;
+static int32_t cut_operation;
+static bool cut_halfway;
+
+void fake_sdk_init() {
+  memset(fake_flash, 0xFF, sizeof(fake_flash));
+  operations = 0;
+  cut_operation = -1;
+}
+
+void fake_sdk_cut_power(const int32_t operation, const bool halfway) {
+  cut_operation = operation;
+  cut_halfway = halfway;
+}
+
+uint32_t fake_sdk_flash_operations() {
+  return operations;
+}
+
+void panic(const char * const fmt, ...) {
+  va_list args;
+  va_start(args, fmt);
+  vfprintf(stderr, fmt, args);
+  va_end(args);
+  fprintf(stderr, "\n");
+  exit(2);
+}
+
+bool multicore_lockout_victim_is_initialized(uint core) {
+  return false;
+}
+
+void multicore_lockout_start_blocking() {
+  panic("Core 1 is not running!");
+}
+
+void multicore_lockout_end_blocking() {
+  panic("Core 1 is not running!");
+}
+
+uint32_t save_and_disable_interrupts() {
+  return 0;
+}
+
+void restore_interrupts(uint32_t status) {
+}
+
+static void check_range(const uint32_t offset, const size_t count, const uint32_t alignment) {
+  if(offset % alignment != 0 || count % alignment != 0 || offset + count > sizeof(fake_flash)) {
+    panic("Flash operation at %u of %u bytes not aligned to %u!", offset, (unsigned)count, alignment);
+  }
+}
+
+// A cut halfway leaves the first half of the operation done
+static size_t begin_operation(const size_t count) {
+  return (int32_t)operations == cut_operation && cut_halfway ? count / 2 : count;
+}
+
+static void end_operation() {
+  if(operations == MAX_OPERATIONS) {
+    panic("Flash operations never end!");
+  }
+  if((int32_t)operations++ == cut_operation) {
+    longjmp(fake_sdk_power_cut, 1);
+  }
+}
+
+void flash_range_erase(uint32_t offset, size_t count) {
+  check_range(offset, count, FLASH_SECTOR_SIZE);
+  memset(fake_flash + offset, 0xFF, begin_operation(count));
+  end_operation();
+}
+
+// Programming can only clear bits
+void flash_range_program(uint32_t offset, const uint8_t * data, size_t count) {
+  check_range(offset, count, FLASH_PAGE_SIZE);
+  const size_t done = begin_operation(count);
+  for(size_t i = 0; i < done; i++) {
+    fake_flash[offset + i] &= data[i];
+  }
+  end_operation();
+}
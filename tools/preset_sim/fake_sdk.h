@@ -0,0 +1,13 @@
+#pragma once
+#include <setjmp.h>
+#include "pico/stdlib.h"
+
+// Flash starts erased. Power is cut by jumping to fake_sdk_power_cut.
+extern jmp_buf fake_sdk_power_cut;
+
+void fake_sdk_init();
+// Cuts power during the erase or program with this index, counted from
+// fake_sdk_init, either once it completed or halfway through it.
+// -1 never cuts.
+void fake_sdk_cut_power(const int32_t operation, const bool halfway);
+uint32_t fake_sdk_flash_operations();
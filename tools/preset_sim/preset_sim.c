@@ -0,0 +1,222 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "preset.h"
+#include "value.h"
+#include "sdhi.h"
+#include "fake_sdk.h"
+
+// Runs the real preset module against a fake flash. A sequence of stores
+// is cut short by a power loss after and halfway through every flash
+// operation it does. After the reboot every preset must recall its last
+// store that was written, or the one that was being written. More stores
+// must then work without losing anything. The sequence keeps a sector of
+// presets that are never stored again, so garbage collection has to
+// append a whole sector of live records. Also checks that values are
+// clamped on recall and that presets of another setup are not recalled.
+
+// 100 values make 512 byte records, 8 per sector
+#define VALUES 100
+#define STORES 600
+#define MORE_STORES 200
+#define LIMIT 1000000
+#define NO_STORE -1
+#define MAX_RUNS (2 * PRESET_SECTORS * 9)
+
+static int32_t values[VALUES];
+static uint32_t setup = 1;
+static const sdhi_t sdhi = {.controls_size = VALUES};
+
+// Stand-ins for the value store and the setup
+void value_set(const uint16_t id, const int32_t value) {
+  values[id] = value;
+}
+
+uint32_t sdhi_hash(const sdhi_t sdhi) {
+  return setup;
+}
+
+int32_t sdhi_clamp_value(const uint16_t id, const int32_t value, const sdhi_t sdhi) {
+  return MIN(MAX(value, -LIMIT), LIMIT);
+}
+
+// Every preset once, then two presets over and over so the first sector
+// stays live for a few laps of the ring, then with an occasional store to
+// any preset
+static uint8_t store_preset(const uint32_t store) {
+  if(store < PRESET_SLOTS) {
+    return store;
+  }
+  if(store >= STORES / 2 && store % 50 == 0) {
+    return (store / 50) % PRESET_SLOTS;
+  }
+  return 8 + store % 2;
+}
+
+// The store number is the first value
+static void store_values(int32_t * const stored, const uint32_t store) {
+  for(uint32_t i = 0; i < VALUES; i++) {
+    stored[i] = store * 7 + i;
+  }
+  stored[0] = store;
+}
+
+static int32_t stores[PRESET_SLOTS];
+static int32_t writing;
+
+static void store(const uint32_t store) {
+  int32_t stored[VALUES];
+  store_values(stored, store);
+  const uint8_t preset = store_preset(store);
+  writing = store;
+  if(!preset_store(preset, stored)) {
+    panic("Store of preset %u failed!", preset);
+  }
+  // A store appends a record and at most collects a whole ring
+  for(uint32_t runs = 0; preset_pending(); runs++) {
+    if(runs == MAX_RUNS) {
+      panic("Store %u of preset %u never finished!", store, preset);
+    }
+    preset_run();
+  }
+  stores[preset] = store;
+  writing = NO_STORE;
+}
+
+// Recalls every preset and checks that it holds one of the allowed stores
+static bool check(const char * const name, const bool exact) {
+  bool ok = true;
+  for(uint8_t preset = 0; preset < PRESET_SLOTS; preset++) {
+    const bool maybe_writing = !exact && writing != NO_STORE && store_preset(writing) == preset;
+    if(!preset_exists(preset)) {
+      if(stores[preset] != NO_STORE) {
+        fprintf(stderr, "%s: preset %u lost\n", name, preset);
+        ok = false;
+      }
+      continue;
+    }
+    preset_recall(preset, values, sdhi);
+    int32_t expected[VALUES];
+    store_values(expected, values[0]);
+    if(values[0] != stores[preset] && !(maybe_writing && values[0] == writing)) {
+      fprintf(stderr, "%s: preset %u holds store %d, expected %d\n", name, preset, values[0], stores[preset]);
+      ok = false;
+    } else if(memcmp(values, expected, sizeof(values)) != 0) {
+      fprintf(stderr, "%s: preset %u values differ\n", name, preset);
+      ok = false;
+    }
+  }
+  return ok;
+}
+
+static void start() {
+  fake_sdk_init();
+  for(uint8_t i = 0; i < PRESET_SLOTS; i++) {
+    stores[i] = NO_STORE;
+  }
+  writing = NO_STORE;
+  setup = 1;
+}
+
+// Runs the stores with power cut during the given operation. Returns
+// false if the cut came after all stores.
+static bool run_cut(const int32_t operation, const bool halfway, bool * const ok) {
+  start();
+  volatile uint32_t next = 0;
+  if(setjmp(fake_sdk_power_cut) == 0) {
+    fake_sdk_cut_power(operation, halfway);
+    preset_init(sdhi);
+    for(; next < STORES; next++) {
+      store(next);
+    }
+    return false;
+  }
+  fake_sdk_cut_power(-1, false);
+  char name[64];
+  snprintf(name, sizeof(name), "cut %s operation %d", halfway ? "halfway through" : "after", operation);
+  preset_init(sdhi);
+  if(!check(name, false)) {
+    *ok = false;
+    return true;
+  }
+  // Whatever the interrupted store left is the newest now
+  if(writing != NO_STORE && preset_exists(store_preset(writing))) {
+    preset_recall(store_preset(writing), values, sdhi);
+    stores[store_preset(writing)] = values[0];
+  }
+  writing = NO_STORE;
+  for(uint32_t i = 0; i < MORE_STORES; i++) {
+    store(STORES + i);
+  }
+  preset_init(sdhi);
+  *ok = check(name, true) && *ok;
+  return true;
+}
+
+static bool check_clamp() {
+  start();
+  preset_init(sdhi);
+  int32_t stored[VALUES] = {0};
+  stored[1] = 2 * LIMIT;
+  stored[2] = -2 * LIMIT;
+  preset_store(0, stored);
+  preset_run();
+  preset_init(sdhi);
+  memset(values, 0, sizeof(values));
+  preset_recall(0, values, sdhi);
+  if(values[1] != LIMIT || values[2] != -LIMIT) {
+    fprintf(stderr, "clamp: recalled %d and %d\n", values[1], values[2]);
+    return false;
+  }
+  return true;
+}
+
+static bool check_setup() {
+  start();
+  preset_init(sdhi);
+  for(uint32_t i = 0; i < STORES / 2; i++) {
+    store(i);
+  }
+  setup = 2;
+  preset_init(sdhi);
+  bool ok = true;
+  if(preset_last() != PRESET_NONE) {
+    fprintf(stderr, "setup: preset %d of the old setup recalled\n", preset_last());
+    ok = false;
+  }
+  for(uint8_t i = 0; i < PRESET_SLOTS; i++) {
+    stores[i] = NO_STORE;
+  }
+  for(uint32_t i = 0; i < STORES; i++) {
+    store(i);
+  }
+  preset_init(sdhi);
+  return check("setup", true) && ok;
+}
+
+int main() {
+  bool ok = true;
+
+  start();
+  preset_init(sdhi);
+  for(uint32_t i = 0; i < STORES; i++) {
+    store(i);
+  }
+  const uint32_t operations = fake_sdk_flash_operations();
+  preset_init(sdhi);
+  ok = check("no cut", true) && ok;
+
+  uint32_t cuts = 0;
+  for(int32_t operation = 0; operation < (int32_t)operations; operation++) {
+    for(uint8_t halfway = 0; halfway < 2; halfway++) {
+      cuts += run_cut(operation, halfway, &ok);
+    }
+  }
+
+  ok = check_clamp() && ok;
+  ok = check_setup() && ok;
+
+  printf("%u flash operations, %u power cuts\n", operations, cuts);
+  printf("%s\n", ok ? "OK" : "FAILED");
+  return ok ? 0 : 1;
+}
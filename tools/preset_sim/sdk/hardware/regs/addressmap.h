@@ -0,0 +1,6 @@
+#pragma once
+#include "pico/stdlib.h"
+
+// Flash is read through the fake flash array
+extern uint8_t fake_flash[PICO_FLASH_SIZE_BYTES];
+#define XIP_BASE ((uintptr_t)fake_flash)
@@ -0,0 +1,6 @@
+#pragma once
+#include "pico/stdlib.h"
+
+bool multicore_lockout_victim_is_initialized(uint core);
+void multicore_lockout_start_blocking();
+void multicore_lockout_end_blocking();
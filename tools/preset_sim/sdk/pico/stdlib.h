@@ -0,0 +1,18 @@
+#pragma once
+// Minimal host stand-in for the parts of the Pico SDK used by preset
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+typedef unsigned int uint;
+
+#ifndef MIN
+#define MIN(a, b) ((a) < (b) ? (a) : (b))
+#endif
+#ifndef MAX
+#define MAX(a, b) ((a) > (b) ? (a) : (b))
+#endif
+
+#define PICO_FLASH_SIZE_BYTES (128 * 1024)
+
+void panic(const char * const fmt, ...);
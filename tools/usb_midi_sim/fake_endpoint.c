@@ -0,0 +1,152 @@
+#include <string.h>
+#include "pico/stdlib.h"
+#include "tusb.h"
+#include "tusb_config.h"
+#include "fake_endpoint.h"
+#include "fake_sdk.h"
+
+#define FIFO_PACKETS (CFG_TUD_MIDI_TX_BUFSIZE / 4)
+#define TRANSFER_PACKETS (CFG_TUD_MIDI_EP_BUFSIZE / 4)
+#define RX_PACKETS (CFG_TUD_MIDI_RX_BUFSIZE / 4)
+#define MAX_RECEIVED 65536
+#define FRAME_NS 1000000
+
+static bool mounted;
+static uint8_t transactions_per_frame;
+
+static uint8_t fifo[FIFO_PACKETS][4];
+static uint16_t fifo_head;
+static uint16_t fifo_level;
+
+static uint8_t transfer[TRANSFER_PACKETS][4];
+static uint8_t transfer_size;
+static bool transfer_done;
+
+static uint64_t frame;
+static uint8_t frame_transactions;
+
+static uint8_t received[MAX_RECEIVED][4];
+static uint32_t received_size;
+
+static uint8_t rx[RX_PACKETS][4];
+static uint16_t rx_head;
+static uint16_t rx_level;
+
+void fake_endpoint_init(const bool connected, const uint8_t transactions) {
+  mounted = connected;
+  transactions_per_frame = transactions;
+  fifo_head = 0;
+  fifo_level = 0;
+  transfer_size = 0;
+  transfer_done = false;
+  frame = 0;
+  frame_transactions = 0;
+  received_size = 0;
+  rx_head = 0;
+  rx_level = 0;
+}
+
+static void arm() {
+  if(transfer_size != 0 || fifo_level == 0) {
+    return;
+  }
+  while(fifo_level > 0 && transfer_size < TRANSFER_PACKETS) {
+    memcpy(transfer[transfer_size++], fifo[fifo_head], 4);
+    fifo_head = (fifo_head + 1) % FIFO_PACKETS;
+    fifo_level--;
+  }
+}
+
+void fake_endpoint_run() {
+  const uint64_t now = fake_sdk_time_ns() / FRAME_NS;
+  if(now != frame) {
+    frame = now;
+    frame_transactions = 0;
+  }
+  if(transfer_size != 0 && !transfer_done && frame_transactions < transactions_per_frame) {
+    if(received_size + transfer_size > MAX_RECEIVED) {
+      panic("Fake host buffer full!");
+    }
+    memcpy(received[received_size], transfer, transfer_size * 4);
+    received_size += transfer_size;
+    transfer_done = true;
+    frame_transactions++;
+  }
+}
+
+bool fake_endpoint_idle() {
+  return fifo_level == 0 && transfer_size == 0;
+}
+
+const uint8_t *fake_endpoint_received(uint32_t * const packets) {
+  *packets = received_size;
+  return received[0];
+}
+
+void fake_endpoint_send(const uint8_t packet[4]) {
+  if(rx_level == RX_PACKETS) {
+    panic("Fake endpoint receive FIFO full!");
+  }
+  memcpy(rx[(rx_head + rx_level) % RX_PACKETS], packet, 4);
+  rx_level++;
+}
+
+bool tusb_init() {
+  return true;
+}
+
+void tud_task() {
+  if(transfer_done) {
+    transfer_size = 0;
+    transfer_done = false;
+  }
+  arm();
+}
+
+bool tud_mounted() {
+  return mounted;
+}
+
+uint32_t tud_midi_available() {
+  return rx_level * 4;
+}
+
+bool tud_midi_packet_read(uint8_t packet[4]) {
+  if(rx_level == 0) {
+    return false;
+  }
+  memcpy(packet, rx[rx_head], 4);
+  rx_head = (rx_head + 1) % RX_PACKETS;
+  rx_level--;
+  return true;
+}
+
+bool tud_midi_packet_write(const uint8_t packet[4]) {
+  if(!mounted || fifo_level == FIFO_PACKETS) {
+    return false;
+  }
+  memcpy(fifo[(fifo_head + fifo_level) % FIFO_PACKETS], packet, 4);
+  fifo_level++;
+  arm();
+  return true;
+}
+
+bool tud_cdc_connected() {
+  return false;
+}
+
+uint32_t tud_cdc_available() {
+  return 0;
+}
+
+uint32_t tud_cdc_read(void * const buffer, const uint32_t size) {
+  return 0;
+}
+
+uint32_t tud_cdc_write(const void * const buffer, const uint32_t size) {
+  return size;
+}
+
+uint32_t tud_cdc_write_flush() {
+  return 0;
+}
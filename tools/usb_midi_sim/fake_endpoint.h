@@ -0,0 +1,19 @@
+#pragma once
+#include "pico/stdlib.h"
+
+// Full speed host and the device side of TinyUSB's MIDI class. Packets
+// written by the device go to a FIFO of CFG_TUD_MIDI_TX_BUFSIZE bytes.
+// One bulk transfer of up to 64 bytes is in flight on the IN endpoint at
+// a time, armed from the FIFO by a packet write or tud_task. The host
+// completes at most transactions_per_frame transfers per 1 ms frame, and
+// the completion is only seen by the device in the next tud_task, as it
+// is handled through TinyUSB's event queue.
+void fake_endpoint_init(const bool mounted, const uint8_t transactions_per_frame);
+// Host side, call as time advances
+void fake_endpoint_run();
+// Nothing queued on the device or in flight
+bool fake_endpoint_idle();
+// Event packets received by the host, 4 bytes each
+const uint8_t *fake_endpoint_received(uint32_t * const packets);
+// Event packet from the host to the device
+void fake_endpoint_send(const uint8_t packet[4]);
@@ -0,0 +1,184 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdarg.h>
+#include <string.h>
+#include "pico/stdlib.h"
+#include "pico/stdio.h"
+#include "pico/util/queue.h"
+#include "hardware/gpio.h"
+#include "hardware/uart.h"
+#include "fake_sdk.h"
+
+#define UARTS 2
+#define UART_BYTE_NS 320000
+#define UART_MAX_SENT 65536
+#define UART_FIFO 32
+
+struct uart_inst {
+  uint8_t index;
+  uint64_t busy_until_ns;
+  uint8_t sent[UART_MAX_SENT];
+  uint64_t start_ns[UART_MAX_SENT];
+  uint32_t sent_size;
+  uart_hw_t hw;
+};
+
+static struct uart_inst uarts[UARTS] = {{.index = 0}, {.index = 1}};
+uart_inst_t * const uart0 = &uarts[0];
+uart_inst_t * const uart1 = &uarts[1];
+
+static uint64_t time_ns;
+
+void fake_sdk_init() {
+  time_ns = 0;
+  for(uint8_t i = 0; i < UARTS; i++) {
+    uarts[i].busy_until_ns = 0;
+    uarts[i].sent_size = 0;
+  }
+}
+
+void fake_sdk_advance_ns(const uint64_t ns) {
+  time_ns += ns;
+}
+
+uint64_t fake_sdk_time_ns() {
+  return time_ns;
+}
+
+const uint8_t *fake_sdk_uart_sent(const uint8_t uart, uint32_t * const size) {
+  *size = uarts[uart].sent_size;
+  return uarts[uart].sent;
+}
+
+bool fake_sdk_uart_busy(const uint8_t uart) {
+  return time_ns < uarts[uart].busy_until_ns;
+}
+
+const uint64_t *fake_sdk_uart_start_ns(const uint8_t uart) {
+  return uarts[uart].start_ns;
+}
+
+// Bytes in the TX FIFO, not counting the one in the shift register
+static uint32_t uart_fifo_level(const uart_inst_t * const uart) {
+  if(time_ns >= uart->busy_until_ns) {
+    return 0;
+  }
+  return (uart->busy_until_ns - time_ns - 1) / UART_BYTE_NS;
+}
+
+void tight_loop_contents() {
+}
+
+uint32_t time_us_32() {
+  return time_ns / 1000;
+}
+
+void panic(const char * const fmt, ...) {
+  va_list args;
+  va_start(args, fmt);
+  vfprintf(stderr, fmt, args);
+  va_end(args);
+  fprintf(stderr, "\n");
+  exit(2);
+}
+
+void stdio_set_driver_enabled(stdio_driver_t * const driver, const bool enabled) {
+}
+
+void gpio_set_function(const uint gpio, const uint function) {
+}
+
+uint uart_init(uart_inst_t * const uart, const uint baudrate) {
+  return baudrate;
+}
+
+void uart_set_format(uart_inst_t * const uart, const uint data_bits, const uint stop_bits, const uint parity) {
+}
+
+bool uart_is_writable(uart_inst_t * const uart) {
+  return uart_fifo_level(uart) < UART_FIFO;
+}
+
+uart_hw_t *uart_get_hw(uart_inst_t * const uart) {
+  const uint32_t level = uart_fifo_level(uart);
+  uart->hw.fr = (level == 0 ? UART_UARTFR_TXFE_BITS : 0)
+    | (level == UART_FIFO ? UART_UARTFR_TXFF_BITS : 0)
+    | (time_ns < uart->busy_until_ns ? UART_UARTFR_BUSY_BITS : 0);
+  return &uart->hw;
+}
+
+bool uart_is_readable(uart_inst_t * const uart) {
+  return false;
+}
+
+void uart_putc(uart_inst_t * const uart, const char c) {
+  if(uart->sent_size == UART_MAX_SENT) {
+    panic("Fake UART buffer full!");
+  }
+  if(!uart_is_writable(uart)) {
+    panic("Fake UART FIFO full!");
+  }
+  uart->start_ns[uart->sent_size] = MAX(time_ns, uart->busy_until_ns);
+  uart->sent[uart->sent_size++] = c;
+  uart->busy_until_ns = uart->start_ns[uart->sent_size - 1] + UART_BYTE_NS;
+}
+
+void uart_read_blocking(uart_inst_t * const uart, uint8_t * const destination, const size_t length) {
+  panic("Fake UART has no input!");
+}
+
+void queue_init(queue_t * const queue, const uint element_size, const uint element_count) {
+  free(queue->data);
+  queue->data = calloc(element_count, element_size);
+  queue->element_size = element_size;
+  queue->element_count = element_count;
+  queue->head = 0;
+  queue->level = 0;
+}
+
+uint queue_get_level(queue_t * const queue) {
+  return queue->level;
+}
+
+bool queue_is_empty(queue_t * const queue) {
+  return queue->level == 0;
+}
+
+bool queue_try_add(queue_t * const queue, const void * const element) {
+  if(queue->level == queue->element_count) {
+    return false;
+  }
+  const uint slot = (queue->head + queue->level) % queue->element_count;
+  memcpy(queue->data + slot * queue->element_size, element, queue->element_size);
+  queue->level++;
+  return true;
+}
+
+bool queue_try_peek(queue_t * const queue, void * const element) {
+  if(queue->level == 0) {
+    return false;
+  }
+  memcpy(element, queue->data + queue->head * queue->element_size, queue->element_size);
+  return true;
+}
+
+bool queue_try_remove(queue_t * const queue, void * const element) {
+  if(!queue_try_peek(queue, element)) {
+    return false;
+  }
+  queue->head = (queue->head + 1) % queue->element_count;
+  queue->level--;
+  return true;
+}
+
+void queue_add_blocking(queue_t * const queue, const void * const element) {
+  if(!queue_try_add(queue, element)) {
+    panic("Queue full, nothing else would ever empty it!");
+  }
+}
+
+void queue_remove_blocking(queue_t * const queue, void * const element) {
+  if(!queue_try_remove(queue, element)) {
+    panic("Queue empty, nothing else would ever fill it!");
+  }
+}
@@ -0,0 +1,13 @@
+#pragma once
+#include "pico/stdlib.h"
+
+// Time only advances when the simulation says so. UARTs record the bytes
+// sent and take 320 us per byte like MIDI at 31250 baud, with a 32 byte
+// TX FIFO in front of the shift register.
+void fake_sdk_init();
+void fake_sdk_advance_ns(const uint64_t ns);
+uint64_t fake_sdk_time_ns();
+const uint8_t *fake_sdk_uart_sent(const uint8_t uart, uint32_t * const size);
+bool fake_sdk_uart_busy(const uint8_t uart);
+// Time each byte sent started on the wire
+const uint64_t *fake_sdk_uart_start_ns(const uint8_t uart);
@@ -0,0 +1,6 @@
+#pragma once
+#include "pico/stdlib.h"
+
+#define GPIO_FUNC_UART 2
+
+void gpio_set_function(const uint gpio, const uint function);
@@ -0,0 +1,6 @@
+#pragma once
+#include "pico/stdlib.h"
+
+static inline void __dmb() {
+  __sync_synchronize();
+}
@@ -0,0 +1,27 @@
+#pragma once
+#include "pico/stdlib.h"
+
+typedef struct uart_inst uart_inst_t;
+
+extern uart_inst_t * const uart0;
+extern uart_inst_t * const uart1;
+
+#define UART_PARITY_NONE 0
+
+#define UART_UARTFR_TXFE_BITS 0x00000080
+#define UART_UARTFR_TXFF_BITS 0x00000020
+#define UART_UARTFR_BUSY_BITS 0x00000008
+
+typedef struct {
+  uint32_t fr;
+} uart_hw_t;
+
+// The flags are updated to the current time on every call
+uart_hw_t *uart_get_hw(uart_inst_t * const uart);
+
+uint uart_init(uart_inst_t * const uart, const uint baudrate);
+void uart_set_format(uart_inst_t * const uart, const uint data_bits, const uint stop_bits, const uint parity);
+bool uart_is_writable(uart_inst_t * const uart);
+bool uart_is_readable(uart_inst_t * const uart);
+void uart_putc(uart_inst_t * const uart, const char c);
+void uart_read_blocking(uart_inst_t * const uart, uint8_t * const destination, const size_t length);
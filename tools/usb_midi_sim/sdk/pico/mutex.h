@@ -0,0 +1,28 @@
+#pragma once
+#include "pico/stdlib.h"
+
+// The simulation runs on one thread, the lock is never held when taken
+typedef struct {
+  bool owned;
+} mutex_t;
+
+#define auto_init_mutex(name) static mutex_t name
+
+static inline void mutex_enter_blocking(mutex_t *mutex) {
+  if(mutex->owned) {
+    panic("Fake mutex taken twice!");
+  }
+  mutex->owned = true;
+}
+
+static inline bool mutex_try_enter(mutex_t *mutex, uint32_t *owner) {
+  if(mutex->owned) {
+    return false;
+  }
+  mutex->owned = true;
+  return true;
+}
+
+static inline void mutex_exit(mutex_t *mutex) {
+  mutex->owned = false;
+}
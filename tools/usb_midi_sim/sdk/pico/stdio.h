@@ -0,0 +1,4 @@
+#pragma once
+#include "pico/stdio/driver.h"
+
+void stdio_set_driver_enabled(stdio_driver_t * const driver, const bool enabled);
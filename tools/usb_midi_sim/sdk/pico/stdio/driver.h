@@ -0,0 +1,8 @@
+#pragma once
+#include "pico/stdlib.h"
+
+typedef struct stdio_driver {
+  void (*out_chars)(const char * buffer, int length);
+  void (*out_flush)();
+  int (*in_chars)(char * buffer, int length);
+} stdio_driver_t;
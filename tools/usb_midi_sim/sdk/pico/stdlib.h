@@ -0,0 +1,21 @@
+#pragma once
+// Minimal host stand-in for the parts of the Pico SDK used by midi and
+// usb_midi
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+typedef unsigned int uint;
+
+#ifndef MIN
+#define MIN(a, b) ((a) < (b) ? (a) : (b))
+#endif
+#ifndef MAX
+#define MAX(a, b) ((a) > (b) ? (a) : (b))
+#endif
+
+#define PICO_ERROR_NO_DATA -3
+
+void tight_loop_contents();
+uint32_t time_us_32();
+void panic(const char * const fmt, ...);
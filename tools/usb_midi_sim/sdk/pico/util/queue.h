@@ -0,0 +1,19 @@
+#pragma once
+#include "pico/stdlib.h"
+
+typedef struct {
+  uint8_t * data;
+  uint element_size;
+  uint element_count;
+  uint head;
+  uint level;
+} queue_t;
+
+void queue_init(queue_t * const queue, const uint element_size, const uint element_count);
+uint queue_get_level(queue_t * const queue);
+bool queue_is_empty(queue_t * const queue);
+bool queue_try_add(queue_t * const queue, const void * const element);
+bool queue_try_remove(queue_t * const queue, void * const element);
+bool queue_try_peek(queue_t * const queue, void * const element);
+void queue_add_blocking(queue_t * const queue, const void * const element);
+void queue_remove_blocking(queue_t * const queue, void * const element);
@@ -0,0 +1,18 @@
+#pragma once
+// Host stand-in for the TinyUSB device API used by usb_midi, backed by
+// the fake endpoint in fake_endpoint.c
+#include "pico/stdlib.h"
+
+bool tusb_init();
+void tud_task();
+bool tud_mounted();
+
+uint32_t tud_midi_available();
+bool tud_midi_packet_read(uint8_t packet[4]);
+bool tud_midi_packet_write(const uint8_t packet[4]);
+
+bool tud_cdc_connected();
+uint32_t tud_cdc_available();
+uint32_t tud_cdc_read(void * const buffer, const uint32_t size);
+uint32_t tud_cdc_write(const void * const buffer, const uint32_t size);
+uint32_t tud_cdc_write_flush();
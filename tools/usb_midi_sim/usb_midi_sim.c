@@ -0,0 +1,745 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "midi.h"
+#include "usb_midi.h"
+#include "action.h"
+#include "value.h"
+#include "fake_sdk.h"
+#include "fake_endpoint.h"
+
+// Runs the real midi and usb_midi modules against a fake USB endpoint.
+// A burst of parameter changes like the one of a preset recall is sent
+// on the DIN port and on the USB port, the streams are decoded back into
+// the resulting synth state and compared with the state the messages
+// should leave. Also checks that the USB port drops output without a
+// host or with a host that doesn't read, that USB output doesn't hold
+// off flash writes, and that messages from the host are received. The
+// action engine is run on a setup of consecutive XG parameters to check
+// the bulk dumps it sends on the wire, and a mapped note must not wait
+// behind DIN traffic queued in the UART.
+
+#define DEFAULT_LOOP_NS 10000
+#define DEFAULT_TRANSACTIONS 16
+#define TIMEOUT_NS 60000000000ull
+#define MAX_MESSAGES 1024
+#define MAX_SYSEX 16384
+#define CHANNELS 16
+
+typedef struct {
+  int16_t controllers[CHANNELS][128];
+  int16_t nrpns[CHANNELS][128 * 128];
+  int16_t programs[CHANNELS];
+  uint8_t sysex[MAX_SYSEX];
+  uint32_t sysex_size;
+} synth_t;
+
+// Parser state while decoding a stream into a synth
+typedef struct {
+  uint8_t status;
+  uint8_t data[2];
+  uint8_t position;
+  bool in_sysex;
+  bool nrpn_selected[CHANNELS];
+  uint8_t nrpn_msb[CHANNELS];
+  uint8_t nrpn_lsb[CHANNELS];
+} decoder_t;
+
+static midi_message_t messages[MAX_MESSAGES];
+static uint32_t messages_size;
+static synth_t expected;
+static synth_t decoded;
+static uint64_t loop_ns = DEFAULT_LOOP_NS;
+static uint8_t transactions = DEFAULT_TRANSACTIONS;
+
+static void usage(const char * const name) {
+  fprintf(stderr,
+          "usage: %s [-l loop_ns] [-t transactions]\n"
+          "  -l  time of one core 1 loop calling midi_run in ns (default %d)\n"
+          "  -t  bulk transactions the host completes per 1 ms frame (default %d)\n",
+          name, DEFAULT_LOOP_NS, DEFAULT_TRANSACTIONS);
+}
+
+static void synth_init(synth_t * const synth) {
+  memset(synth->controllers, 0xFF, sizeof(synth->controllers));
+  memset(synth->nrpns, 0xFF, sizeof(synth->nrpns));
+  memset(synth->programs, 0xFF, sizeof(synth->programs));
+  synth->sysex_size = 0;
+}
+
+static void sysex_byte(synth_t * const synth, const uint8_t byte) {
+  if(synth->sysex_size == MAX_SYSEX) {
+    fprintf(stderr, "Too much system exclusive data\n");
+    exit(1);
+  }
+  synth->sysex[synth->sysex_size++] = byte;
+}
+
+static void add(const midi_message_t message) {
+  messages[messages_size++] = message;
+  switch(message.type) {
+  case MIDI_CONTROLLER_MESSAGE:
+    expected.controllers[message.value.controller.channel][message.value.controller.number] = message.value.controller.value;
+    break;
+  case MIDI_PROGRAM_CHANGE_MESSAGE:
+    expected.programs[message.value.program.channel] = message.value.program.number;
+    break;
+  case MIDI_NRPN_MESSAGE:
+    expected.nrpns[message.value.rpn.channel][message.value.rpn.msb << 7 | message.value.rpn.lsb] = message.value.rpn.value;
+    break;
+  case MIDI_EXCLUSIVE_MESSAGE:
+    if(!message.value.exclusive.continued) {
+      sysex_byte(&expected, 0xF0);
+      sysex_byte(&expected, message.value.exclusive.manufacturer_id);
+    }
+    for(uint8_t i = 0; i < message.value.exclusive.data_size; i++) {
+      sysex_byte(&expected, message.value.exclusive.data[i]);
+    }
+    if(!message.value.exclusive.more) {
+      sysex_byte(&expected, 0xF7);
+    }
+    break;
+  default:
+    break;
+  }
+}
+
+static void controller(const uint8_t channel, const uint8_t number, const uint8_t value) {
+  const midi_message_t message = {
+    .type = MIDI_CONTROLLER_MESSAGE,
+    .value.controller = {channel, number, value}
+  };
+  add(message);
+}
+
+// The messages the drum setup sends for every drum, on all channels, and
+// system exclusive messages of every length, whole and sent in parts
+static void build_messages() {
+  messages_size = 0;
+  synth_init(&expected);
+  for(uint8_t channel = 0; channel < CHANNELS; channel++) {
+    midi_message_t xg = {
+      .type = MIDI_EXCLUSIVE_MESSAGE,
+      .value.exclusive = {
+        .channel = channel,
+        .manufacturer_id = 0x43,
+        .data = {0x10, 0x4C, 0x08, channel, 0x07, 0x01},
+        .data_size = 6
+      }
+    };
+    add(xg);
+    controller(channel, 0, 127);
+    controller(channel, 32, 0);
+    const midi_message_t program = {
+      .type = MIDI_PROGRAM_CHANGE_MESSAGE,
+      .value.program = {channel, channel * 3}
+    };
+    add(program);
+    controller(channel, 7, 100 - channel);
+    controller(channel, 10, 64 + channel);
+    controller(channel, 73, 60);
+    controller(channel, 72, 70);
+    for(uint8_t lsb = 0x64; lsb < 0x6A; lsb++) {
+      const midi_message_t nrpn = {
+        .type = MIDI_NRPN_MESSAGE,
+        .value.rpn = {channel, 0x01, lsb, (lsb + channel) & 0x7F}
+      };
+      add(nrpn);
+    }
+  }
+  for(uint8_t size = 0; size <= MIDI_EXCLUSIVE_MAX_LENGTH; size++) {
+    midi_message_t sysex = {
+      .type = MIDI_EXCLUSIVE_MESSAGE,
+      .value.exclusive = {
+        .manufacturer_id = 0x7D,
+        .data_size = size
+      }
+    };
+    for(uint8_t i = 0; i < size; i++) {
+      sysex.value.exclusive.data[i] = (size + i) & 0x7F;
+    }
+    add(sysex);
+  }
+  for(uint8_t part = 0; part < 4; part++) {
+    midi_message_t sysex = {
+      .type = MIDI_EXCLUSIVE_MESSAGE,
+      .value.exclusive = {
+        .manufacturer_id = 0x7D,
+        .data_size = MIDI_EXCLUSIVE_MAX_LENGTH - part,
+        .continued = part > 0,
+        .more = part < 3
+      }
+    };
+    for(uint8_t i = 0; i < sysex.value.exclusive.data_size; i++) {
+      sysex.value.exclusive.data[i] = (part * 16 + i) & 0x7F;
+    }
+    add(sysex);
+  }
+}
+
+static void decode_message(decoder_t * const decoder, synth_t * const synth) {
+  const uint8_t channel = decoder->status & 0x0F;
+  switch(decoder->status & 0xF0) {
+  case 0xB0: {
+    const uint8_t number = decoder->data[0];
+    const uint8_t value = decoder->data[1];
+    switch(number) {
+    case 99:
+      decoder->nrpn_msb[channel] = value;
+      decoder->nrpn_selected[channel] = true;
+      return;
+    case 98:
+      decoder->nrpn_lsb[channel] = value;
+      decoder->nrpn_selected[channel] = true;
+      return;
+    case 6:
+      if(decoder->nrpn_selected[channel] && !(decoder->nrpn_msb[channel] == 127 && decoder->nrpn_lsb[channel] == 127)) {
+        synth->nrpns[channel][decoder->nrpn_msb[channel] << 7 | decoder->nrpn_lsb[channel]] = value;
+        return;
+      }
+      break;
+    }
+    synth->controllers[channel][number] = value;
+    return;
+  }
+  case 0xC0:
+    synth->programs[channel] = decoder->data[0];
+    return;
+  }
+}
+
+static void decode_byte(decoder_t * const decoder, synth_t * const synth, const uint8_t byte) {
+  if(byte >= 0xF8) {
+    return;
+  }
+  if(byte == 0xF0) {
+    decoder->in_sysex = true;
+    decoder->status = 0;
+    sysex_byte(synth, byte);
+  } else if(byte == 0xF7) {
+    decoder->in_sysex = false;
+    sysex_byte(synth, byte);
+  } else if(byte & 0x80) {
+    decoder->in_sysex = false;
+    decoder->status = byte;
+    decoder->position = 0;
+  } else if(decoder->in_sysex) {
+    sysex_byte(synth, byte);
+  } else if(decoder->status != 0) {
+    decoder->data[decoder->position++] = byte;
+    const uint8_t size = (decoder->status & 0xE0) == 0xC0 ? 1 : 2;
+    if(decoder->position == size) {
+      decode_message(decoder, synth);
+      decoder->position = 0;
+    }
+  }
+}
+
+static uint8_t packet_size(const uint8_t cin) {
+  switch(cin) {
+  case 0x5:
+  case 0xF:
+    return 1;
+  case 0x2:
+  case 0x6:
+  case 0xC:
+  case 0xD:
+    return 2;
+  default:
+    return 3;
+  }
+}
+
+// Packets must carry the code index number matching their bytes
+static bool check_packet(const uint8_t * const packet) {
+  const uint8_t cin = packet[0] & 0x0F;
+  if(packet[0] >> 4 != 0) {
+    return false;
+  }
+  if(packet[1] >= 0x80 && packet[1] < 0xF0) {
+    return cin == packet[1] >> 4;
+  }
+  const uint8_t size = packet_size(cin);
+  const bool end = packet[size] == 0xF7;
+  switch(cin) {
+  case 0x4:
+    return !end;
+  case 0x5:
+  case 0x6:
+  case 0x7:
+    return end;
+  default:
+    return false;
+  }
+}
+
+static bool decode_packets(const uint8_t * const packets, const uint32_t size, synth_t * const synth) {
+  decoder_t decoder = {0};
+  synth_init(synth);
+  for(uint32_t i = 0; i < size; i++) {
+    const uint8_t * const packet = packets + i * 4;
+    if(!check_packet(packet)) {
+      fprintf(stderr, "Bad packet %02X %02X %02X %02X\n", packet[0], packet[1], packet[2], packet[3]);
+      return false;
+    }
+    for(uint8_t j = 0; j < packet_size(packet[0] & 0x0F); j++) {
+      decode_byte(&decoder, synth, packet[1 + j]);
+    }
+  }
+  return true;
+}
+
+static void decode_bytes(const uint8_t * const bytes, const uint32_t size, synth_t * const synth) {
+  decoder_t decoder = {0};
+  synth_init(synth);
+  for(uint32_t i = 0; i < size; i++) {
+    decode_byte(&decoder, synth, bytes[i]);
+  }
+}
+
+static bool compare(const char * const name) {
+  bool same = memcmp(expected.controllers, decoded.controllers, sizeof(expected.controllers)) == 0
+    && memcmp(expected.nrpns, decoded.nrpns, sizeof(expected.nrpns)) == 0
+    && memcmp(expected.programs, decoded.programs, sizeof(expected.programs)) == 0
+    && expected.sysex_size == decoded.sysex_size
+    && memcmp(expected.sysex, decoded.sysex, expected.sysex_size) == 0;
+  if(!same) {
+    fprintf(stderr, "%s: decoded state differs from the messages sent\n", name);
+  }
+  return same;
+}
+
+static void start_host(const bool mounted, const uint8_t transactions_per_frame) {
+  fake_sdk_init();
+  fake_endpoint_init(mounted, transactions_per_frame);
+  usb_midi_init();
+  midi_init();
+}
+
+static void start(const bool mounted) {
+  start_host(mounted, transactions);
+}
+
+static void step() {
+  midi_run();
+  fake_endpoint_run();
+  fake_sdk_advance_ns(loop_ns);
+}
+
+static bool din_done() {
+  return !fake_sdk_uart_busy(1);
+}
+
+static bool usb_done() {
+  return fake_endpoint_idle();
+}
+
+// Sends all messages on a port the way action_update does, keeping the
+// ring topped up, and returns the time until the last byte is out
+static uint64_t run(const midi_port_t port, bool (* const done)()) {
+  uint32_t next = 0;
+  const uint64_t begin = fake_sdk_time_ns();
+  while(next < messages_size || !midi_port_idle(port) || !done()) {
+    for(uint32_t space = midi_can_send_messages(port); next < messages_size && space > 1; space--) {
+      midi_send_messages(port, &messages[next++], 1);
+    }
+    if(next == messages_size) {
+      midi_flush();
+    }
+    step();
+    if(fake_sdk_time_ns() - begin > TIMEOUT_NS) {
+      fprintf(stderr, "Timed out with %u of %u messages queued\n", next, messages_size);
+      exit(1);
+    }
+  }
+  return fake_sdk_time_ns() - begin;
+}
+
+// Received controllers and program changes go to core 0, a received
+// note goes to every target mapped to its channel and note
+static bool check_receive() {
+  start(true);
+  midi_set_mapped_note(0, 0, 36, MIDI_PORT_USB, 9, 38, MIDI_VELOCITY_LINEAR);
+  midi_set_mapped_note(1, 0, 36, MIDI_PORT_USB, 9, 42, MIDI_VELOCITY_HARD);
+  midi_set_mapped_note(2, 1, 36, MIDI_PORT_USB, 9, 50, MIDI_VELOCITY_LINEAR);
+  const uint8_t packets[][4] = {
+    {0x0B, 0xB2, 7, 100},
+    {0x0C, 0xC3, 5, 0},
+    {0x0F, 0xF8, 0, 0},
+    {0x09, 0x90, 36, 100},
+    {0x08, 0x80, 36, 0}
+  };
+  for(uint8_t i = 0; i < sizeof(packets) / sizeof(packets[0]); i++) {
+    fake_endpoint_send(packets[i]);
+  }
+  for(uint16_t i = 0; i < 1000; i++) {
+    step();
+  }
+  midi_message_t received[4];
+  const uint32_t size = midi_get_available_messages(received, 4);
+  bool ok = size == 2
+    && received[0].type == MIDI_CONTROLLER_MESSAGE
+    && received[0].value.controller.channel == 2
+    && received[0].value.controller.number == 7
+    && received[0].value.controller.value == 100
+    && received[1].type == MIDI_PROGRAM_CHANGE_MESSAGE
+    && received[1].value.program.channel == 3
+    && received[1].value.program.number == 5;
+  uint32_t sent_size;
+  const uint8_t * const sent = fake_endpoint_received(&sent_size);
+  const uint8_t notes[] = {
+    0x09, 0x99, 42, 100 * 100 / 127,
+    0x09, 0x99, 38, 100,
+    0x08, 0x89, 42, 0,
+    0x08, 0x89, 38, 0
+  };
+  ok = ok && sent_size == 4 && memcmp(sent, notes, sizeof(notes)) == 0;
+  if(!ok) {
+    fprintf(stderr, "receive: got %u messages and %u mapped packets\n", size, sent_size);
+  }
+  return ok;
+}
+
+// A mapped note must not land within a system exclusive message sent in
+// parts, even when the last part is queued late
+static bool check_notes_in_exclusive() {
+  start(true);
+  midi_set_mapped_note(0, 0, 36, MIDI_PORT_USB, 9, 38, MIDI_VELOCITY_LINEAR);
+  midi_message_t parts[2] = {
+    {
+      .type = MIDI_EXCLUSIVE_MESSAGE,
+      .value.exclusive = {.manufacturer_id = 0x7D, .data = {1, 2, 3, 4}, .data_size = 4, .more = true}
+    },
+    {
+      .type = MIDI_EXCLUSIVE_MESSAGE,
+      .value.exclusive = {.data = {5, 6}, .data_size = 2, .continued = true}
+    }
+  };
+  midi_send_messages(MIDI_PORT_USB, &parts[0], 1);
+  step();
+  const uint8_t note_on[4] = {0x09, 0x90, 36, 100};
+  fake_endpoint_send(note_on);
+  for(uint16_t i = 0; i < 1000; i++) {
+    step();
+  }
+  midi_send_messages(MIDI_PORT_USB, &parts[1], 1);
+  for(uint16_t i = 0; i < 1000; i++) {
+    step();
+  }
+  const uint8_t expected_packets[] = {
+    0x04, 0xF0, 0x7D, 1,
+    0x04, 2, 3, 4,
+    0x07, 5, 6, 0xF7,
+    0x09, 0x99, 38, 100
+  };
+  uint32_t size;
+  const uint8_t * const packets = fake_endpoint_received(&size);
+  const bool ok = size == 4 && memcmp(packets, expected_packets, sizeof(expected_packets)) == 0;
+  if(!ok) {
+    fprintf(stderr, "notes in exclusive: got %u packets\n", size);
+  }
+  return ok;
+}
+
+static bool stalled_done() {
+  return true;
+}
+
+// A host that is mounted but doesn't read MIDI must neither block the
+// port nor keep midi_idle false, which would hold off preset writes
+static bool check_stalled_host(uint64_t * const stalled_ns) {
+  start_host(true, 0);
+  midi_send_messages(MIDI_PORT_USB, messages, 1);
+  bool ok = midi_idle();
+  if(!ok) {
+    fprintf(stderr, "usb with stalled host: not idle with output queued\n");
+  }
+  *stalled_ns = run(MIDI_PORT_USB, stalled_done);
+  return ok;
+}
+
+// A mapped note must not wait behind parameter traffic queued in the UART,
+// only behind the rest of the message on the wire. With one byte waiting
+// in the TX FIFO that is at most 3 bytes, a core 1 loop and the next USB
+// frame later.
+#define NOTE_LATENCY_NS (3 * 320000 + 1000000)
+
+static bool check_note_latency(uint64_t * const latency_ns) {
+  start(true);
+  midi_set_mapped_note(0, 0, 36, MIDI_PORT_DIN, 9, 38, MIDI_VELOCITY_LINEAR);
+  const uint8_t note_on[4] = {0x09, 0x90, 36, 100};
+  uint64_t note_ns = 0;
+  uint32_t note_from = 0;
+  for(uint32_t i = 0; note_ns == 0 || fake_sdk_time_ns() - note_ns < 20 * NOTE_LATENCY_NS; i++) {
+    while(midi_can_send_messages(MIDI_PORT_DIN) > 1) {
+      midi_message_t traffic = {
+        .type = MIDI_CONTROLLER_MESSAGE,
+        .value.controller = {i % CHANNELS, 7, i & 0x7F}
+      };
+      midi_send_messages(MIDI_PORT_DIN, &traffic, 1);
+    }
+    if(note_ns == 0 && fake_sdk_time_ns() >= 100000000) {
+      fake_endpoint_send(note_on);
+      note_ns = fake_sdk_time_ns();
+      fake_sdk_uart_sent(1, &note_from);
+    }
+    step();
+  }
+  uint32_t size;
+  const uint8_t * const bytes = fake_sdk_uart_sent(1, &size);
+  const uint64_t * const start_ns = fake_sdk_uart_start_ns(1);
+  for(uint32_t i = note_from; i + 1 < size; i++) {
+    if(bytes[i] == 0x99 && bytes[i + 1] == 38) {
+      *latency_ns = start_ns[i] - note_ns;
+      if(*latency_ns > NOTE_LATENCY_NS) {
+        fprintf(stderr, "note latency: %.3f ms behind traffic\n", *latency_ns / 1e6);
+        return false;
+      }
+      return true;
+    }
+  }
+  fprintf(stderr, "note latency: note never sent\n");
+  return false;
+}
+
+// Stand-ins for the setup, every control is an integer sent as it is
+sdhi_control_type_t sdhi_type(const uint16_t id, const sdhi_t sdhi) {
+  return SDHI_CONTROL_TYPE_INTEGER;
+}
+
+int32_t sdhi_integer(const uint16_t id, const int32_t * const values, const sdhi_t sdhi) {
+  return values[id];
+}
+
+int32_t sdhi_enumeration(const uint16_t id, const int32_t * const values, const sdhi_t sdhi) {
+  return values[id];
+}
+
+bool sdhi_stored_value(const uint16_t id, const int32_t value, int32_t * const stored, const sdhi_t sdhi) {
+  *stored = value;
+  return true;
+}
+
+#define XG_CONTROL(a, id) { \
+    .port = MIDI_PORT_DIN, \
+    .channel = (a) >> 8, \
+    .type = ACTION_XG_PARAMETER_CHANGE_1, \
+    .configuration.xg_parameter_change = { \
+      .parameter = {.parameter.value = (a) & 0xFF, .type = PARAMETER_VALUE}, \
+      .value = {.parameter.control = {id, 0}, .type = PARAMETER_CONTROL} \
+    } \
+  }
+
+// Volume, velocity sense depth and offset and pan of part 2, listed out
+// of address order. Then a run of 20 parameters of part 0 from 30h, which
+// takes two parts of a system exclusive message. A controller on the AUX
+// port comes last.
+#define XG_SHORT 0
+#define XG_LONG 4
+#define XG_LONG_SIZE 20
+#define AUX_CONTROL 24
+#define XG_CONTROLS 25
+
+static const action_t xg_actions[] = {
+  XG_CONTROL(0x20E, 3), XG_CONTROL(0x20B, 0), XG_CONTROL(0x20C, 1), XG_CONTROL(0x20D, 2),
+  XG_CONTROL(0x030, 4), XG_CONTROL(0x031, 5), XG_CONTROL(0x032, 6), XG_CONTROL(0x033, 7),
+  XG_CONTROL(0x034, 8), XG_CONTROL(0x035, 9), XG_CONTROL(0x036, 10), XG_CONTROL(0x037, 11),
+  XG_CONTROL(0x038, 12), XG_CONTROL(0x039, 13), XG_CONTROL(0x03A, 14), XG_CONTROL(0x03B, 15),
+  XG_CONTROL(0x03C, 16), XG_CONTROL(0x03D, 17), XG_CONTROL(0x03E, 18), XG_CONTROL(0x03F, 19),
+  XG_CONTROL(0x040, 20), XG_CONTROL(0x041, 21), XG_CONTROL(0x042, 22), XG_CONTROL(0x043, 23),
+  {
+    .port = MIDI_PORT_AUX,
+    .channel = 0,
+    .type = ACTION_CONTROLLER,
+    .configuration.controller = {
+      .number = {.parameter.value = 7, .type = PARAMETER_VALUE},
+      .value = {.parameter.control = {AUX_CONTROL, 0}, .type = PARAMETER_CONTROL}
+    }
+  }
+};
+static const actions_t xg_setup = {xg_actions, sizeof(xg_actions) / sizeof(xg_actions[0])};
+static const sdhi_t xg_sdhi = {.controls_size = XG_CONTROLS};
+static int32_t xg_values[XG_CONTROLS];
+static action_value_t xg_action_values[sizeof(xg_actions) / sizeof(xg_actions[0])];
+
+// Runs action updates and core 1 until everything is on the wire
+static void drain_actions(bool pending) {
+  for(uint64_t begin = fake_sdk_time_ns(); pending || !midi_port_idle(MIDI_PORT_DIN) || !midi_port_idle(MIDI_PORT_AUX) || fake_sdk_uart_busy(0) || fake_sdk_uart_busy(1);) {
+    if(pending) {
+      pending = action_update(xg_setup, xg_sdhi, xg_values, xg_action_values);
+    }
+    step();
+    if(fake_sdk_time_ns() - begin > TIMEOUT_NS) {
+      fprintf(stderr, "Timed out sending actions\n");
+      exit(1);
+    }
+  }
+}
+
+static bool check_wire(const char * const name, const uint8_t uart, const uint32_t from, const uint8_t * const expected_bytes, const uint32_t expected_size) {
+  uint32_t size;
+  const uint8_t * const bytes = fake_sdk_uart_sent(uart, &size);
+  if(size - from != expected_size || memcmp(bytes + from, expected_bytes, expected_size) != 0) {
+    fprintf(stderr, "%s: %u bytes on the wire:", name, size - from);
+    for(uint32_t i = from; i < size; i++) {
+      fprintf(stderr, " %02X", bytes[i]);
+    }
+    fprintf(stderr, "\n");
+    return false;
+  }
+  return true;
+}
+
+// XG bulk dump: F0 43 0n 4C, byte count MSB and LSB, address high, mid
+// and low, the data, a checksum making the 7 bit sum of byte count,
+// address, data and checksum 0, F7. For part 2 from 0Bh with 64h 40h 40h
+// 0Ah the sum is 00+04+08+02+0B+64+40+40+0A = 107h, so the checksum is
+// 80h - 07h = 79h.
+static bool check_xg_bulk_dump() {
+  start(true);
+  value_init(xg_values, XG_CONTROLS);
+  const int32_t part_2[] = {100, 64, 64, 10};
+  for(uint8_t i = 0; i < 4; i++) {
+    xg_values[XG_SHORT + i] = part_2[i];
+  }
+  for(uint8_t i = 0; i < XG_LONG_SIZE; i++) {
+    xg_values[XG_LONG + i] = i * 5;
+  }
+  xg_values[AUX_CONTROL] = 90;
+  drain_actions(action_init(xg_setup, xg_sdhi, xg_values, xg_action_values));
+
+  // Part 0 goes first, its 28 data bytes are sent in a part of 16 and one
+  // of 12 without anything in between. The sum is 402h, checksum 7Eh.
+  const uint8_t dumps[] = {
+    0xF0, 0x43, 0x00, 0x4C, 0x00, 0x14, 0x08, 0x00, 0x30,
+    0x00, 0x05, 0x0A, 0x0F, 0x14, 0x19, 0x1E, 0x23, 0x28, 0x2D,
+    0x32, 0x37, 0x3C, 0x41, 0x46, 0x4B, 0x50, 0x55, 0x5A, 0x5F,
+    0x7E, 0xF7,
+    0xF0, 0x43, 0x00, 0x4C, 0x00, 0x04, 0x08, 0x02, 0x0B,
+    0x64, 0x40, 0x40, 0x0A,
+    0x79, 0xF7
+  };
+  const uint8_t aux[] = {0xB0, 7, 90};
+  bool ok = check_wire("xg bulk dump", 1, 0, dumps, sizeof(dumps));
+  ok = check_wire("xg bulk dump aux", 0, 0, aux, sizeof(aux)) && ok;
+
+  // Only changed parameters are sent, consecutive ones as a bulk dump of
+  // their own. 00h+02h+08h+00h+33h+01h+02h = 40h, checksum 40h.
+  uint32_t sent;
+  fake_sdk_uart_sent(1, &sent);
+  value_set(XG_LONG + 3, 1);
+  value_set(XG_LONG + 4, 2);
+  value_set(XG_LONG + 10, 3);
+  drain_actions(true);
+  const uint8_t changes[] = {
+    0xF0, 0x43, 0x00, 0x4C, 0x00, 0x02, 0x08, 0x00, 0x33, 0x01, 0x02, 0x40, 0xF7,
+    0xF0, 0x43, 0x10, 0x4C, 0x08, 0x00, 0x3A, 0x03, 0xF7
+  };
+  ok = check_wire("xg changes", 1, sent, changes, sizeof(changes)) && ok;
+
+  // With the DIN port full the pass is blocked. The AUX port still gets
+  // its controller, the dump follows once there is room.
+  for(uint8_t i = 0; midi_can_send_messages(MIDI_PORT_DIN) > 1; i++) {
+    midi_message_t filler = {
+      .type = MIDI_CONTROLLER_MESSAGE,
+      .value.controller = {15, 1, i & 0x7F}
+    };
+    midi_send_messages(MIDI_PORT_DIN, &filler, 1);
+  }
+  uint32_t aux_sent;
+  fake_sdk_uart_sent(0, &aux_sent);
+  for(uint8_t i = 0; i < XG_LONG_SIZE; i++) {
+    value_set(XG_LONG + i, 127 - i);
+  }
+  value_set(AUX_CONTROL, 91);
+  bool blocked = action_update(xg_setup, xg_sdhi, xg_values, xg_action_values);
+  if(!blocked || midi_port_idle(MIDI_PORT_AUX)) {
+    fprintf(stderr, "xg blocked: %s\n", blocked ? "aux controller held back" : "pass not blocked");
+    ok = false;
+  }
+  fake_sdk_uart_sent(1, &sent);
+  drain_actions(blocked);
+  uint32_t size;
+  const uint8_t * const bytes = fake_sdk_uart_sent(1, &size);
+  // Skip the fillers, B0 and running status pairs
+  uint32_t from = sent;
+  while(from < size && bytes[from] != 0xF0) {
+    from++;
+  }
+  uint8_t resumed[9 + XG_LONG_SIZE + 2] = {0xF0, 0x43, 0x00, 0x4C, 0x00, 0x14, 0x08, 0x00, 0x30};
+  uint8_t sum = 0x00 + 0x14 + 0x08 + 0x00 + 0x30;
+  for(uint8_t i = 0; i < XG_LONG_SIZE; i++) {
+    resumed[9 + i] = 127 - i;
+    sum += 127 - i;
+  }
+  resumed[9 + XG_LONG_SIZE] = -sum & 0x7F;
+  resumed[10 + XG_LONG_SIZE] = 0xF7;
+  ok = check_wire("xg blocked", 1, from, resumed, sizeof(resumed)) && ok;
+  const uint8_t aux_change[] = {0xB0, 7, 91};
+  ok = check_wire("xg blocked aux", 0, aux_sent, aux_change, sizeof(aux_change)) && ok;
+  return ok;
+}
+
+int main(int argc, char **argv) {
+  int option;
+  while((option = getopt(argc, argv, "l:t:h")) != -1) {
+    switch(option) {
+    case 'l':
+      loop_ns = strtoull(optarg, NULL, 0);
+      break;
+    case 't':
+      transactions = atoi(optarg);
+      break;
+    default:
+      usage(argv[0]);
+      return option == 'h' ? 0 : 1;
+    }
+  }
+  if(loop_ns == 0 || transactions == 0) {
+    usage(argv[0]);
+    return 1;
+  }
+
+  bool ok = true;
+  build_messages();
+
+  start(true);
+  const uint64_t din_ns = run(MIDI_PORT_DIN, din_done);
+  uint32_t bytes_size;
+  const uint8_t * const bytes = fake_sdk_uart_sent(1, &bytes_size);
+  decode_bytes(bytes, bytes_size, &decoded);
+  ok = compare("din") && ok;
+
+  start(true);
+  const uint64_t usb_ns = run(MIDI_PORT_USB, usb_done);
+  uint32_t packets_size;
+  const uint8_t * const packets = fake_endpoint_received(&packets_size);
+  ok = decode_packets(packets, packets_size, &decoded) && compare("usb") && ok;
+
+  start(false);
+  const uint64_t unmounted_ns = run(MIDI_PORT_USB, usb_done);
+  uint32_t unmounted_size;
+  fake_endpoint_received(&unmounted_size);
+  if(unmounted_size != 0) {
+    fprintf(stderr, "usb without host: %u packets received\n", unmounted_size);
+    ok = false;
+  }
+
+  uint64_t stalled_ns = 0;
+  ok = check_stalled_host(&stalled_ns) && ok;
+  ok = check_receive() && ok;
+  ok = check_notes_in_exclusive() && ok;
+  ok = check_xg_bulk_dump() && ok;
+  uint64_t latency_ns = 0;
+  ok = check_note_latency(&latency_ns) && ok;
+
+  printf("%u messages\n", messages_size);
+  printf("din:  %6u bytes   %9.3f ms  %8.0f messages/s\n", bytes_size, din_ns / 1e6, messages_size / (din_ns / 1e9));
+  printf("usb:  %6u packets %9.3f ms  %8.0f messages/s  %.0fx din\n", packets_size, usb_ns / 1e6, messages_size / (usb_ns / 1e9), (double)din_ns / usb_ns);
+  printf("usb without host: %.3f ms\n", unmounted_ns / 1e6);
+  printf("usb with stalled host: %.3f ms\n", stalled_ns / 1e6);
+  printf("din note behind traffic: %.3f ms\n", latency_ns / 1e6);
+  printf("%s\n", ok ? "OK" : "FAILED");
+  return ok ? 0 : 1;
+}
@@ -0,0 +1,56 @@
+#pragma once
+#include "pico/stdlib.h"
+
+#define TRACE_HISTOGRAM_BUCKETS 16
+#define TRACE_MAX_COUNTERS 4
+
+typedef enum {
+  TRACE_UPDATE_DISPLAYS,
+  TRACE_UPDATE_AND_FLIP,
+  TRACE_UPDATE_VALUES,
+  TRACE_ACTION_UPDATE,
+  TRACE_CORE1_LOOP,
+  TRACE_STAGES
+} trace_stage_t;
+
+// Boot milestones, recorded once as time since power on
+typedef enum {
+  TRACE_BOOT_DISPLAY_INIT,
+  TRACE_BOOT_SETUP,
+  TRACE_BOOT_CORE1,
+  TRACE_BOOT_FIRST_FRAME,
+  TRACE_BOOT_MIDI_DUMP,
+  TRACE_BOOT_STAGES
+} trace_boot_stage_t;
+
+// Counters kept by other modules, dumped and reset along with the stages
+typedef void (*trace_counters_dump_t)();
+typedef void (*trace_counters_reset_t)();
+
+#ifdef TRACE_ENABLED
+
+void trace_init();
+uint32_t trace_begin();
+void trace_end(const trace_stage_t stage, const uint32_t begin);
+void trace_period(const trace_stage_t stage);
+void trace_boot(const trace_boot_stage_t stage);
+void trace_frame();
+void trace_add_counters(const trace_counters_dump_t dump, const trace_counters_reset_t reset);
+void trace_reset();
+void trace_dump();
+void trace_poll();
+
+#else
+
+static inline void trace_init() {}
+static inline uint32_t trace_begin() { return 0; }
+static inline void trace_end(const trace_stage_t stage, const uint32_t begin) {}
+static inline void trace_period(const trace_stage_t stage) {}
+static inline void trace_boot(const trace_boot_stage_t stage) {}
+static inline void trace_frame() {}
+static inline void trace_add_counters(const trace_counters_dump_t dump, const trace_counters_reset_t reset) {}
+static inline void trace_reset() {}
+static inline void trace_dump() {}
+static inline void trace_poll() {}
+
+#endif
@@ -0,0 +1,236 @@
+#include <stdio.h>
+#include "hardware/sync.h"
+#include "hardware/structs/xip_ctrl.h"
+#include "trace.h"
+
+#ifdef TRACE_ENABLED
+
+typedef struct {
+  uint32_t min;
+  uint32_t max;
+  uint64_t total;
+  uint32_t count;
+  uint32_t last;
+  uint32_t histogram[TRACE_HISTOGRAM_BUCKETS];
+} trace_counter_t;
+
+static const char * const stage_names[TRACE_STAGES] = {
+  "update displays",
+  "update and flip",
+  "update values",
+  "action update",
+  "core 1 loop"
+};
+
+static const char * const boot_stage_names[TRACE_BOOT_STAGES] = {
+  "display init",
+  "setup",
+  "core 1",
+  "first frame",
+  "midi dump"
+};
+
+// Core recording each stage
+static const uint8_t stage_cores[TRACE_STAGES] = {
+  [TRACE_UPDATE_DISPLAYS] = 0,
+  [TRACE_UPDATE_AND_FLIP] = 0,
+  [TRACE_UPDATE_VALUES] = 0,
+  [TRACE_ACTION_UPDATE] = 0,
+  [TRACE_CORE1_LOOP] = 1
+};
+
+// Each stage is only recorded and reset from its own core, so no locking
+// is needed. A reset requested on the other core is done by the next
+// trace_end or trace_period there.
+static trace_counter_t counters[TRACE_STAGES];
+static volatile bool reset_pending[2];
+static uint32_t boot_times[TRACE_BOOT_STAGES];
+
+// XIP cache misses per frame. The cache counters count accesses of both
+// cores and are cleared every frame.
+static trace_counter_t xip_misses;
+static uint64_t xip_accesses;
+static uint64_t xip_hits;
+
+static trace_counters_dump_t counters_dumps[TRACE_MAX_COUNTERS];
+static trace_counters_reset_t counters_resets[TRACE_MAX_COUNTERS];
+// Core that added the counters, the one updating them
+static uint8_t counters_cores[TRACE_MAX_COUNTERS];
+static uint8_t counters_size;
+
+static uint8_t bucket(const uint32_t duration) {
+  // Bucket i holds values in [2^(i-1), 2^i), bucket 0 holds 0
+  if(duration == 0) {
+    return 0;
+  }
+  return MIN(32 - __builtin_clz(duration), TRACE_HISTOGRAM_BUCKETS - 1);
+}
+
+static void record(trace_counter_t * const counter, const uint32_t duration) {
+  if(counter->count == 0 || duration < counter->min) {
+    counter->min = duration;
+  }
+  if(duration > counter->max) {
+    counter->max = duration;
+  }
+  counter->total += duration;
+  counter->count++;
+  counter->histogram[bucket(duration)]++;
+}
+
+static void reset_core(const uint8_t core);
+
+static void poll_reset() {
+  const uint8_t core = get_core_num();
+  if(reset_pending[core]) {
+    reset_core(core);
+  }
+}
+
+void trace_init() {
+  trace_reset();
+}
+
+uint32_t trace_begin() {
+  return time_us_32();
+}
+
+void trace_end(const trace_stage_t stage, const uint32_t begin) {
+  poll_reset();
+  record(&counters[stage], time_us_32() - begin);
+}
+
+void trace_period(const trace_stage_t stage) {
+  poll_reset();
+  const uint32_t now = time_us_32();
+  trace_counter_t * const counter = &counters[stage];
+  if(counter->last != 0) {
+    record(counter, now - counter->last);
+  }
+  counter->last = now;
+}
+
+void trace_boot(const trace_boot_stage_t stage) {
+  if(boot_times[stage] == 0) {
+    boot_times[stage] = time_us_32();
+  }
+}
+
+// Hits are read first, so a concurrent access can't make them exceed
+// the accesses
+void trace_frame() {
+  const uint32_t hits = xip_ctrl_hw->ctr_hit;
+  const uint32_t accesses = xip_ctrl_hw->ctr_acc;
+  xip_ctrl_hw->ctr_hit = 0;
+  xip_ctrl_hw->ctr_acc = 0;
+  xip_hits += hits;
+  xip_accesses += accesses;
+  record(&xip_misses, accesses - hits);
+}
+
+void trace_add_counters(const trace_counters_dump_t dump, const trace_counters_reset_t reset) {
+  if(counters_size == TRACE_MAX_COUNTERS) {
+    panic("Too many trace counters!");
+  }
+  counters_dumps[counters_size] = dump;
+  counters_resets[counters_size] = reset;
+  counters_cores[counters_size] = get_core_num();
+  counters_size++;
+}
+
+static void reset_counter(trace_counter_t * const counter) {
+  counter->min = 0;
+  counter->max = 0;
+  counter->total = 0;
+  counter->count = 0;
+  counter->last = 0;
+  for(uint8_t j = 0; j < TRACE_HISTOGRAM_BUCKETS; j++) {
+    counter->histogram[j] = 0;
+  }
+}
+
+// The XIP cache counters belong to core 0, which calls trace_frame
+static void reset_core(const uint8_t core) {
+  reset_pending[core] = false;
+  __dmb();
+  for(uint8_t i = 0; i < TRACE_STAGES; i++) {
+    if(stage_cores[i] == core) {
+      reset_counter(&counters[i]);
+    }
+  }
+  if(core == 0) {
+    reset_counter(&xip_misses);
+    xip_accesses = 0;
+    xip_hits = 0;
+    xip_ctrl_hw->ctr_hit = 0;
+    xip_ctrl_hw->ctr_acc = 0;
+  }
+  for(uint8_t i = 0; i < counters_size; i++) {
+    if(counters_cores[i] == core) {
+      counters_resets[i]();
+    }
+  }
+}
+
+// Resets the counters of the calling core now and those of the other
+// core when it next records a stage
+void trace_reset() {
+  const uint8_t core = get_core_num();
+  reset_pending[core ^ 1] = true;
+  reset_core(core);
+}
+
+static void dump_counter(const char * const name, const trace_counter_t counter, const char * const unit) {
+  if(counter.count == 0) {
+    printf("%-16s no samples\n", name);
+    return;
+  }
+  printf("%-16s n=%lu min=%lu%s avg=%lu%s max=%lu%s\n",
+         name,
+         (unsigned long)counter.count,
+         (unsigned long)counter.min, unit,
+         (unsigned long)(counter.total / counter.count), unit,
+         (unsigned long)counter.max, unit);
+  printf("%-16s", "");
+  for(uint8_t j = 0; j < TRACE_HISTOGRAM_BUCKETS; j++) {
+    printf(" %lu", (unsigned long)counter.histogram[j]);
+  }
+  printf("\n");
+}
+
+void trace_dump() {
+  for(uint8_t i = 0; i < TRACE_BOOT_STAGES; i++) {
+    if(boot_times[i] == 0) {
+      printf("boot %-11s pending\n", boot_stage_names[i]);
+    } else {
+      printf("boot %-11s %luus\n", boot_stage_names[i], (unsigned long)boot_times[i]);
+    }
+  }
+  for(uint8_t i = 0; i < TRACE_STAGES; i++) {
+    dump_counter(stage_names[i], counters[i], "us");
+  }
+  dump_counter("xip misses", xip_misses, "");
+  if(xip_accesses != 0) {
+    printf("%-16s hits=%llu accesses=%llu rate=%lu.%lu%%\n",
+           "xip cache",
+           (unsigned long long)xip_hits,
+           (unsigned long long)xip_accesses,
+           (unsigned long)(xip_hits * 100 / xip_accesses),
+           (unsigned long)(xip_hits * 1000 / xip_accesses % 10));
+  }
+  for(uint8_t i = 0; i < counters_size; i++) {
+    counters_dumps[i]();
+  }
+}
+
+// 't' over stdio dumps the counters, 'r' resets them
+void trace_poll() {
+  const int c = getchar_timeout_us(0);
+  if(c == 't') {
+    trace_dump();
+  } else if(c == 'r') {
+    trace_reset();
+  }
+}
+
+#endif
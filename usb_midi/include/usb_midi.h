@@ -0,0 +1,20 @@
+#pragma once
+#include "pico/stdlib.h"
+
+// USB device with a MIDI interface and a CDC interface taking over stdio.
+// Call after stdio_init_all, usb_midi_task has to run for the device to
+// enumerate.
+void usb_midi_init();
+// Runs the USB stack. The functions below must be called from the same
+// core.
+void usb_midi_task();
+
+// Outgoing MIDI byte stream, split into USB MIDI event packets. Running
+// status and system exclusive are supported. Without a host the bytes
+// are dropped, and when the host doesn't read them for 10 ms they are
+// dropped until it reads again, so the port never blocks for long.
+bool usb_midi_writable();
+void usb_midi_write(const uint8_t byte);
+
+// MIDI bytes of the next received event packet, 0 if there is none
+uint8_t usb_midi_read(uint8_t * const bytes);
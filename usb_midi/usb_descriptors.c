@@ -0,0 +1,101 @@
+#include <string.h>
+#include "pico/unique_id.h"
+#include "tusb.h"
+
+// TinyUSB's test vendor id, fine for development boards
+#define USB_VID 0xCAFE
+#define USB_PID 0x4050
+
+enum {
+  ITF_NUM_CDC,
+  ITF_NUM_CDC_DATA,
+  ITF_NUM_MIDI,
+  ITF_NUM_MIDI_STREAMING,
+  ITF_NUM_TOTAL
+};
+
+#define EPNUM_CDC_NOTIF 0x81
+#define EPNUM_CDC_OUT 0x02
+#define EPNUM_CDC_IN 0x82
+#define EPNUM_MIDI_OUT 0x03
+#define EPNUM_MIDI_IN 0x83
+
+#define CONFIG_TOTAL_LEN (TUD_CONFIG_DESC_LEN + TUD_CDC_DESC_LEN + TUD_MIDI_DESC_LEN)
+
+enum {
+  STRING_LANGUAGE,
+  STRING_MANUFACTURER,
+  STRING_PRODUCT,
+  STRING_SERIAL,
+  STRING_CDC,
+  STRING_MIDI,
+  STRINGS
+};
+
+// The CDC interface uses an interface association, which needs the
+// miscellaneous device class
+static const tusb_desc_device_t device = {
+  .bLength = sizeof(tusb_desc_device_t),
+  .bDescriptorType = TUSB_DESC_DEVICE,
+  .bcdUSB = 0x0200,
+  .bDeviceClass = TUSB_CLASS_MISC,
+  .bDeviceSubClass = MISC_SUBCLASS_COMMON,
+  .bDeviceProtocol = MISC_PROTOCOL_IAD,
+  .bMaxPacketSize0 = CFG_TUD_ENDPOINT0_SIZE,
+  .idVendor = USB_VID,
+  .idProduct = USB_PID,
+  .bcdDevice = 0x0100,
+  .iManufacturer = STRING_MANUFACTURER,
+  .iProduct = STRING_PRODUCT,
+  .iSerialNumber = STRING_SERIAL,
+  .bNumConfigurations = 1
+};
+
+static const uint8_t configuration[] = {
+  TUD_CONFIG_DESCRIPTOR(1, ITF_NUM_TOTAL, 0, CONFIG_TOTAL_LEN, 0x00, 100),
+  TUD_CDC_DESCRIPTOR(ITF_NUM_CDC, STRING_CDC, EPNUM_CDC_NOTIF, 8, EPNUM_CDC_OUT, EPNUM_CDC_IN, 64),
+  TUD_MIDI_DESCRIPTOR(ITF_NUM_MIDI, STRING_MIDI, EPNUM_MIDI_OUT, EPNUM_MIDI_IN, 64)
+};
+
+static const char * const strings[STRINGS] = {
+  [STRING_MANUFACTURER] = "SDHI",
+  [STRING_PRODUCT] = "SDHI display board",
+  [STRING_CDC] = "SDHI stdio",
+  [STRING_MIDI] = "SDHI MIDI"
+};
+
+#define MAX_STRING 31
+
+static char serial[2 * PICO_UNIQUE_BOARD_ID_SIZE_BYTES + 1];
+static uint16_t string_descriptor[1 + MAX_STRING];
+
+const uint8_t * tud_descriptor_device_cb() {
+  return (const uint8_t *)&device;
+}
+
+const uint8_t * tud_descriptor_configuration_cb(uint8_t index) {
+  return configuration;
+}
+
+const uint16_t * tud_descriptor_string_cb(uint8_t index, uint16_t langid) {
+  uint8_t size;
+  if(index == STRING_LANGUAGE) {
+    // English (United States)
+    string_descriptor[1] = 0x0409;
+    size = 1;
+  } else if(index < STRINGS) {
+    const char * string = strings[index];
+    if(index == STRING_SERIAL) {
+      pico_get_unique_board_id_string(serial, sizeof(serial));
+      string = serial;
+    }
+    size = MIN(strlen(string), MAX_STRING);
+    for(uint8_t i = 0; i < size; i++) {
+      string_descriptor[1 + i] = string[i];
+    }
+  } else {
+    return NULL;
+  }
+  string_descriptor[0] = (TUSB_DESC_STRING << 8) | (2 * size + 2);
+  return string_descriptor;
+}
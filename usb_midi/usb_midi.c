@@ -0,0 +1,212 @@
+#include <string.h>
+#include "pico/stdlib.h"
+#include "pico/mutex.h"
+#include "pico/stdio.h"
+#include "pico/stdio/driver.h"
+#include "tusb.h"
+#include "usb_midi.h"
+
+// Code index numbers, the first byte of an event packet on cable 0
+#define CIN_SYSEX 0x4
+#define CIN_SYSEX_END_1 0x5
+#define CIN_SINGLE_BYTE 0xF
+
+#define SYSEX_START 0xF0
+#define SYSEX_END 0xF7
+
+// Time a printf waits for the host to take the output
+#define STDIO_TIMEOUT_US 10000
+// Time a packet waits for a mounted host that doesn't read MIDI. After
+// that packets are dropped until the host takes one again.
+#define PACKET_TIMEOUT_US 10000
+
+// TinyUSB must not be entered from both cores at once. Core 1 runs the
+// stack and MIDI, core 0 only stdio, which never waits for the lock.
+auto_init_mutex(usb_mutex);
+
+// Status byte of the outgoing stream, SYSEX_START within system exclusive
+static uint8_t status;
+// Bytes of the message being split into packets
+static uint8_t message[3];
+static uint8_t position;
+// Packet that didn't fit in the endpoint buffer yet
+static uint8_t packet[4];
+static bool pending;
+static uint32_t pending_time;
+static bool stalled;
+
+static uint8_t data_size(const uint8_t status) {
+  switch(status & 0xF0) {
+  case 0xC0:
+  case 0xD0:
+    return 1;
+  default:
+    return 2;
+  }
+}
+
+static void flush() {
+  if(!pending) {
+    return;
+  }
+  mutex_enter_blocking(&usb_mutex);
+  const bool written = !tud_mounted() || tud_midi_packet_write(packet);
+  mutex_exit(&usb_mutex);
+  if(written) {
+    pending = false;
+    stalled = false;
+  } else if(stalled || time_us_32() - pending_time > PACKET_TIMEOUT_US) {
+    pending = false;
+    stalled = true;
+  }
+}
+
+static void send(const uint8_t cin, const uint8_t * const bytes, const uint8_t size) {
+  packet[0] = cin;
+  for(uint8_t i = 0; i < 3; i++) {
+    packet[1 + i] = i < size ? bytes[i] : 0;
+  }
+  pending = true;
+  pending_time = time_us_32();
+  flush();
+}
+
+bool usb_midi_writable() {
+  flush();
+  return !pending;
+}
+
+void usb_midi_write(const uint8_t byte) {
+  if(byte >= 0xF8) {
+    // Real time messages can appear anywhere, even within a message
+    send(CIN_SINGLE_BYTE, &byte, 1);
+  } else if(byte == SYSEX_START) {
+    status = byte;
+    message[0] = byte;
+    position = 1;
+  } else if(byte == SYSEX_END) {
+    if(status == SYSEX_START) {
+      message[position++] = byte;
+      send(CIN_SYSEX_END_1 + position - 1, message, position);
+    }
+    status = 0;
+    position = 0;
+  } else if(byte >= 0xF0) {
+    // System common messages are never sent
+    status = 0;
+    position = 0;
+  } else if(byte & 0x80) {
+    status = byte;
+    message[0] = byte;
+    position = 1;
+  } else if(status == SYSEX_START) {
+    message[position++] = byte;
+    if(position == 3) {
+      send(CIN_SYSEX, message, 3);
+      position = 0;
+    }
+  } else if(status != 0) {
+    // Running status, every packet carries the status byte anyway
+    if(position == 0) {
+      message[0] = status;
+      position = 1;
+    }
+    message[position++] = byte;
+    if(position == 1 + data_size(status)) {
+      send(status >> 4, message, position);
+      position = 0;
+    }
+  }
+}
+
+uint8_t usb_midi_read(uint8_t * const bytes) {
+  uint8_t received[4];
+  mutex_enter_blocking(&usb_mutex);
+  const bool read = tud_midi_available() && tud_midi_packet_read(received);
+  mutex_exit(&usb_mutex);
+  if(!read) {
+    return 0;
+  }
+  uint8_t size;
+  switch(received[0] & 0x0F) {
+  case 0x5:
+  case 0xF:
+    size = 1;
+    break;
+  case 0x2:
+  case 0x6:
+  case 0xC:
+  case 0xD:
+    size = 2;
+    break;
+  case 0x3:
+  case 0x4:
+  case 0x7:
+  case 0x8:
+  case 0x9:
+  case 0xA:
+  case 0xB:
+  case 0xE:
+    size = 3;
+    break;
+  default:
+    // Reserved for future extensions
+    return 0;
+  }
+  memcpy(bytes, received + 1, size);
+  return size;
+}
+
+// stdio goes to the CDC interface. Output is dropped without a terminal
+// and when the host stops reading, so tracing never stalls core 0. While
+// core 1 holds the lock the write is retried within the same timeout.
+static void stdio_out_chars(const char * buffer, int length) {
+  uint32_t progress_time = time_us_32();
+  while(length > 0 && time_us_32() - progress_time < STDIO_TIMEOUT_US) {
+    if(!mutex_try_enter(&usb_mutex, NULL)) {
+      continue;
+    }
+    if(!tud_cdc_connected()) {
+      mutex_exit(&usb_mutex);
+      return;
+    }
+    const uint32_t written = tud_cdc_write(buffer, length);
+    tud_cdc_write_flush();
+    mutex_exit(&usb_mutex);
+    if(written > 0) {
+      buffer += written;
+      length -= written;
+      progress_time = time_us_32();
+    }
+  }
+}
+
+static int stdio_in_chars(char * buffer, int length) {
+  if(!mutex_try_enter(&usb_mutex, NULL)) {
+    return PICO_ERROR_NO_DATA;
+  }
+  const int read = tud_cdc_available() ? tud_cdc_read(buffer, length) : PICO_ERROR_NO_DATA;
+  mutex_exit(&usb_mutex);
+  return read;
+}
+
+static stdio_driver_t usb_stdio = {
+  .out_chars = stdio_out_chars,
+  .in_chars = stdio_in_chars
+};
+
+void usb_midi_init() {
+  status = 0;
+  position = 0;
+  pending = false;
+  stalled = false;
+  tusb_init();
+  stdio_set_driver_enabled(&usb_stdio, true);
+}
+
+void usb_midi_task() {
+  mutex_enter_blocking(&usb_mutex);
+  tud_task();
+  mutex_exit(&usb_mutex);
+  flush();
+}
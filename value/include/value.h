@@ -0,0 +1,36 @@
+#pragma once
+#include "pico/stdlib.h"
+
+// Changes not consumed within this many writes are lost, the consumer
+// then gets VALUE_ALL and has to treat every value as changed
+#ifndef VALUE_LOG_SIZE
+#define VALUE_LOG_SIZE 64
+#endif
+
+#define VALUE_NONE -1
+#define VALUE_ALL -2
+
+// RENDER redraws the slots of changed controls. ACTION sends the MIDI
+// messages of changed controls, values received from the synth are only
+// sent back when the control can't show them exactly.
+typedef enum {
+  VALUE_CONSUMER_RENDER,
+  VALUE_CONSUMER_ACTION,
+  VALUE_CONSUMER_PRESET,
+  VALUE_CONSUMERS
+} value_consumer_t;
+
+// Values are read directly from the array, all writes go through
+// value_set so that consumers see them. Not thread safe, values are only
+// written and consumed on core 0.
+void value_init(int32_t * const values, const uint32_t size);
+void value_set(const uint16_t id, const int32_t value);
+uint32_t value_version(const uint16_t id);
+bool value_changed(const value_consumer_t consumer);
+bool value_dirty(const value_consumer_t consumer, const uint16_t id);
+
+// Next id changed since the consumer last got it, VALUE_NONE when the
+// consumer is up to date. Every id is returned once however often it
+// changed.
+int32_t value_next(const value_consumer_t consumer);
+void value_consume_all(const value_consumer_t consumer);
@@ -0,0 +1,68 @@
+#include "value.h"
+#include "setup_limits.h"
+
+// Every change gets the next version. changes is a log of the id written
+// at each version, versions holds the version of the last write of each id.
+// A log entry older than the version of its id is a duplicate and is
+// skipped, so consumers do work proportional to the changed ids.
+
+static int32_t *values;
+static uint32_t version;
+static uint32_t versions[SETUP_MAX_VALUES];
+static uint16_t changes[VALUE_LOG_SIZE];
+static uint32_t cursors[VALUE_CONSUMERS];
+
+void value_init(int32_t * const v, const uint32_t size) {
+  if(size > SETUP_MAX_VALUES) {
+    panic("Too many values!");
+  }
+  values = v;
+  version = 0;
+  for(uint32_t i = 0; i < size; i++) {
+    versions[i] = 0;
+  }
+  for(uint8_t i = 0; i < VALUE_CONSUMERS; i++) {
+    cursors[i] = 0;
+  }
+}
+
+void value_set(const uint16_t id, const int32_t value) {
+  if(values[id] == value) {
+    return;
+  }
+  values[id] = value;
+  version++;
+  versions[id] = version;
+  changes[version % VALUE_LOG_SIZE] = id;
+}
+
+uint32_t value_version(const uint16_t id) {
+  return versions[id];
+}
+
+bool value_changed(const value_consumer_t consumer) {
+  return cursors[consumer] != version;
+}
+
+bool value_dirty(const value_consumer_t consumer, const uint16_t id) {
+  return (int32_t)(versions[id] - cursors[consumer]) > 0;
+}
+
+int32_t value_next(const value_consumer_t consumer) {
+  if(version - cursors[consumer] > VALUE_LOG_SIZE) {
+    cursors[consumer] = version;
+    return VALUE_ALL;
+  }
+  while(cursors[consumer] != version) {
+    const uint32_t current = ++cursors[consumer];
+    const uint16_t id = changes[current % VALUE_LOG_SIZE];
+    if(versions[id] == current) {
+      return id;
+    }
+  }
+  return VALUE_NONE;
+}
+
+void value_consume_all(const value_consumer_t consumer) {
+  cursors[consumer] = version;
+}